@@ -105,15 +105,28 @@ void ram_getsize(paddr_t *lo, paddr_t *hi);
 /*
  * TLB shootdown bits.
  *
- * We'll take up to 16 invalidations before just flushing the whole TLB.
+ * Each shootdown carries a batch of physical pages to unmap, so a cpu
+ * should rarely have more than one queued; the limit of 16 before
+ * flushing the whole TLB is never reached (see mmu_shootdown).
  */
 
+/*
+ * Per-address-space MMU state (see arch/mips/vm/mmu.c).
+ */
+#include <platform/maxcpus.h>
+
+struct mmu_as {
+	uint32_t ma_id;		/* unique address space number */
+	uint32_t ma_gen[MAXCPUS];  /* software TLB generation on each cpu */
+	uint32_t ma_asid[MAXCPUS]; /* ASID on each cpu, with generation */
+};
+
+struct semaphore;
+
 struct tlbshootdown {
-	/*
-	 * Change this to what you need for your VM design.
-	 */
-	struct addrspace *ts_addrspace;
-	vaddr_t ts_vaddr;
+	const paddr_t *ts_paddrs;	/* physical pages to unmap */
+	unsigned ts_npages;
+	struct semaphore *ts_done;	/* V'd when done */
 };
 
 #define TLBSHOOTDOWN_MAX 16
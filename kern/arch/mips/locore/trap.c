@@ -28,6 +28,7 @@
  */
 
 #include <types.h>
+#include <kern/wait.h>
 #include <signal.h>
 #include <lib.h>
 #include <mips/specialreg.h>
@@ -109,12 +110,14 @@ kill_curthread(vaddr_t epc, unsigned code, vaddr_t vaddr)
 	}
 
 	/*
-	 * You will probably want to change this.
+	 * There are no signal handlers, so the process dies, and its
+	 * parent sees it as killed by the signal.
 	 */
 
 	kprintf("Fatal user mode trap %u sig %d (%s, epc 0x%x, vaddr 0x%x)\n",
 		code, sig, trapcodenames[code], epc, vaddr);
-	panic("I don't know how to handle this\n");
+	curthread->t_exitstatus = _MKWAIT_SIG(sig);
+	thread_exit();
 }
 
 /*
@@ -31,12 +31,105 @@
 #include <kern/errno.h>
 #include <kern/syscall.h>
 #include <lib.h>
+#include <copyinout.h>
 #include <mips/trapframe.h>
 #include <thread.h>
 #include <current.h>
 #include <syscall.h>
+#include "opt-dumbvm.h"
 
 
+/*
+ * pread and pwrite take the fd, buffer, and length in a0-a2, and the
+ * 64-bit position, aligned, at sp+16.
+ */
+static
+int
+syscall_getpos(struct trapframe *tf, off_t *pos)
+{
+	return copyin((const_userptr_t)(tf->tf_sp + 16), pos, sizeof(*pos));
+}
+
+/*
+ * lseek takes the fd in a0, the 64-bit position in a2/a3, and whence
+ * at sp+16, and returns a 64-bit position: the high word goes in v0
+ * via RETVAL like any other return value, and the low word in v1.
+ */
+static
+int
+syscall_lseek(struct trapframe *tf, int32_t *retval)
+{
+	int whence;
+	off_t pos;
+	int result;
+
+	result = copyin((const_userptr_t)(tf->tf_sp + 16), &whence,
+			sizeof(whence));
+	if (result) {
+		return result;
+	}
+
+	pos = ((off_t)tf->tf_a2 << 32) | tf->tf_a3;
+	result = sys_lseek(tf->tf_a0, pos, whence, &pos);
+	if (result) {
+		return result;
+	}
+
+	*retval = (int32_t)(pos >> 32);
+	tf->tf_v1 = (uint32_t)pos;
+	return 0;
+}
+
+/*
+ * select has five arguments: nfds and the three descriptor sets in
+ * a0-a3, then the timeout pointer at sp+16.
+ */
+static
+int
+syscall_select(struct trapframe *tf, int32_t *retval)
+{
+	userptr_t timeout;
+	int result;
+
+	result = copyin((const_userptr_t)(tf->tf_sp + 16), &timeout,
+			sizeof(timeout));
+	if (result) {
+		return result;
+	}
+
+	return sys_select(tf->tf_a0, (userptr_t)tf->tf_a1,
+			  (userptr_t)tf->tf_a2, (userptr_t)tf->tf_a3,
+			  timeout, retval);
+}
+
+#if !OPT_DUMBVM
+/*
+ * mmap has six arguments: addr, len, prot, and flags in a0-a3, then
+ * the fd at sp+16 and the 64-bit offset, aligned, at sp+24.
+ */
+static
+int
+syscall_mmap(struct trapframe *tf, int32_t *retval)
+{
+	int fd;
+	off_t offset;
+	int result;
+
+	result = copyin((const_userptr_t)(tf->tf_sp + 16), &fd, sizeof(fd));
+	if (result) {
+		return result;
+	}
+	result = copyin((const_userptr_t)(tf->tf_sp + 24), &offset,
+			sizeof(offset));
+	if (result) {
+		return result;
+	}
+
+	return sys_mmap((userptr_t)tf->tf_a0, (size_t)tf->tf_a1, tf->tf_a2,
+			tf->tf_a3, fd, offset, retval);
+}
+#endif
+
 /*
  * System call dispatcher.
  *
@@ -80,6 +173,7 @@ syscall(struct trapframe *tf)
 {
 	int callno;
 	int32_t retval;
+	off_t pos;
 	int err;
 
 	KASSERT(curthread != NULL);
@@ -104,11 +198,128 @@ syscall(struct trapframe *tf)
 		err = sys_reboot(tf->tf_a0);
 		break;
 
+	    case SYS_fork:
+		err = sys_fork(tf, &retval);
+		break;
+
+	    case SYS_execv:
+		err = sys_execv((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1);
+		break;
+
+	    case SYS__exit:
+		sys__exit(tf->tf_a0);
+		panic("sys__exit returned\n");
+		break;
+
+	    case SYS_waitpid:
+		err = sys_waitpid(tf->tf_a0, (userptr_t)tf->tf_a1, tf->tf_a2,
+				  &retval);
+		break;
+
+	    case SYS_getpid:
+		err = sys_getpid(&retval);
+		break;
+
 	    case SYS___time:
 		err = sys___time((userptr_t)tf->tf_a0,
 				 (userptr_t)tf->tf_a1);
 		break;
 
+	    case SYS_nanosleep:
+		err = sys_nanosleep((const_userptr_t)tf->tf_a0,
+				    (userptr_t)tf->tf_a1);
+		break;
+
+	    case SYS_open:
+		err = sys_open((userptr_t)tf->tf_a0, tf->tf_a1, tf->tf_a2,
+			       &retval);
+		break;
+
+	    case SYS_pipe:
+		err = sys_pipe((userptr_t)tf->tf_a0);
+		break;
+
+	    case SYS_read:
+		err = sys_read(tf->tf_a0, (userptr_t)tf->tf_a1,
+			       (size_t)tf->tf_a2, &retval);
+		break;
+
+	    case SYS_write:
+		err = sys_write(tf->tf_a0, (userptr_t)tf->tf_a1,
+				(size_t)tf->tf_a2, &retval);
+		break;
+
+	    case SYS_pread:
+		err = syscall_getpos(tf, &pos);
+		if (err == 0) {
+			err = sys_pread(tf->tf_a0, (userptr_t)tf->tf_a1,
+					(size_t)tf->tf_a2, pos, &retval);
+		}
+		break;
+
+	    case SYS_pwrite:
+		err = syscall_getpos(tf, &pos);
+		if (err == 0) {
+			err = sys_pwrite(tf->tf_a0, (userptr_t)tf->tf_a1,
+					 (size_t)tf->tf_a2, pos, &retval);
+		}
+		break;
+
+	    case SYS_readv:
+		err = sys_readv(tf->tf_a0, (const_userptr_t)tf->tf_a1,
+				tf->tf_a2, &retval);
+		break;
+
+	    case SYS_writev:
+		err = sys_writev(tf->tf_a0, (const_userptr_t)tf->tf_a1,
+				 tf->tf_a2, &retval);
+		break;
+
+	    case SYS_close:
+		err = sys_close(tf->tf_a0);
+		break;
+
+	    case SYS_lseek:
+		err = syscall_lseek(tf, &retval);
+		break;
+
+	    case SYS_dup2:
+		err = sys_dup2(tf->tf_a0, tf->tf_a1, &retval);
+		break;
+
+	    case SYS_select:
+		err = syscall_select(tf, &retval);
+		break;
+
+	    case SYS_poll:
+		err = sys_poll((userptr_t)tf->tf_a0, tf->tf_a1, tf->tf_a2,
+			       &retval);
+		break;
+
+#if !OPT_DUMBVM
+	    case SYS_sbrk:
+		err = sys_sbrk((intptr_t)tf->tf_a0, &retval);
+		break;
+
+	    case SYS_mmap:
+		err = syscall_mmap(tf, &retval);
+		break;
+
+	    case SYS_munmap:
+		err = sys_munmap((userptr_t)tf->tf_a0, (size_t)tf->tf_a1);
+		break;
+
+	    case SYS_mprotect:
+		err = sys_mprotect((userptr_t)tf->tf_a0, (size_t)tf->tf_a1,
+				   tf->tf_a2);
+		break;
+
+	    case SYS_madvise:
+		err = sys_madvise((userptr_t)tf->tf_a0, (size_t)tf->tf_a1,
+				  tf->tf_a2);
+		break;
+#endif
+
 	    /* Add stuff here */
  
 	    default:
@@ -149,13 +360,16 @@ syscall(struct trapframe *tf)
 /*
  * Enter user mode for a newly forked process.
  *
- * This function is provided as a reminder. You need to write
- * both it and the code that calls it.
- *
- * Thus, you can trash it and do things another way if you prefer.
+ * TF is a copy of the parent's trapframe from its fork call, on the
+ * child's own kernel stack. Make fork return 0 in the child, step
+ * past the syscall instruction, and go.
  */
 void
 enter_forked_process(struct trapframe *tf)
 {
-	(void)tf;
+	tf->tf_v0 = 0;		/* child's return value */
+	tf->tf_a3 = 0;		/* signal no error */
+	tf->tf_epc += 4;
+
+	mips_usermode(tf);
 }
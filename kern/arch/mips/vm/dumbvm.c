@@ -99,6 +99,12 @@ vm_tlbshootdown_all(void)
 	panic("dumbvm tried to do tlb shootdown?!\n");
 }
 
+void
+vm_idle(void)
+{
+	/* nothing to do */
+}
+
 void
 vm_tlbshootdown(const struct tlbshootdown *ts)
 {
@@ -0,0 +1,614 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <spl.h>
+#include <spinlock.h>
+#include <cpu.h>
+#include <current.h>
+#include <thread.h>
+#include <synch.h>
+#include <addrspace.h>
+#include <coremap.h>
+#include <mips/tlb.h>
+#include <platform/maxcpus.h>
+#include <vm.h>
+
+/*
+ * MIPS MMU (TLB) handling for the VM system.
+ *
+ * TLB entries are tagged with address space IDs (ASIDs), so context
+ * switches don't flush the TLB. There are only 63 ASIDs (0 means no
+ * address space), so each cpu hands them out separately, in
+ * generations: when it runs out, it flushes its TLB, starts a new
+ * generation, and gives each address space a new ASID the next time
+ * it is activated there. An address space remembers its ASID on each
+ * cpu along with the generation it came from; if the generation is
+ * old, the ASID is no longer its own.
+ *
+ * Each cpu also has a software TLB: a direct-mapped cache of recently
+ * loaded translations, tagged by address space number, which is not
+ * limited the way ASIDs are. It holds more than the real TLB, and
+ * survives ASID rollover, so mmu_refill can often handle a TLB miss
+ * without going through the page tables. Entries are invalidated by
+ * unmapping, by physical page shootdown, and by bumping the address
+ * space's generation number for the cpu, which makes all its entries
+ * there stale at once.
+ *
+ * Because an address space only runs on one cpu at a time, its
+ * translations on the other cpus can be dropped without talking to
+ * them, just by making its ASIDs and software TLB entries there
+ * unusable; see mmu_disown.
+ *
+ * Except for mmu_shootdown, mmu_invalidate, and mmu_revoke, these
+ * operate on the current cpu only, and must not be interrupted while
+ * frobbing it.
+ * All the TLB access functions load EntryHi and thus change the
+ * current ASID, so anything that uses them for some other ASID must
+ * put it back with mmu_setasid afterwards.
+ */
+
+/* Number of software TLB entries per cpu. Must be a power of 2. */
+#define STLB_SIZE	256
+#define STLB_HASH(id, vaddr) \
+	((((vaddr) / PAGE_SIZE) ^ ((id) * 37)) & (STLB_SIZE - 1))
+
+struct stlb_entry {
+	uint32_t se_id;		/* address space number, 0 if unused */
+	uint32_t se_gen;	/* address space generation */
+	uint32_t se_ehi;	/* TLB entry */
+	uint32_t se_elo;
+};
+
+struct mmu_cpu {
+	struct stlb_entry mc_stlb[STLB_SIZE];
+	unsigned mc_nlookups;	/* mmu_refill calls */
+	unsigned mc_nhits;	/* ... that hit */
+	unsigned mc_nprefills;	/* neighbouring pages loaded with them */
+};
+
+/*
+ * Per-cpu state, indexed by cpu number. The software TLBs are
+ * allocated on first use. mmu_tlbnext is the next TLB slot to
+ * replace; slots are reused round-robin.
+ *
+ * mmu_curasid is the ASID in use; mmu_asidgen and mmu_asidnext are
+ * the current ASID generation and next ASID to hand out in it. ASID
+ * tags stored in address spaces are generation * NUM_TLBPID + ASID;
+ * generations start at 1 so that a tag of 0 is never valid.
+ */
+static struct mmu_cpu *mmu_cpus[MAXCPUS];
+static unsigned mmu_tlbnext[MAXCPUS];
+static unsigned mmu_curasid[MAXCPUS];
+static uint32_t mmu_asidgen[MAXCPUS];
+static unsigned mmu_asidnext[MAXCPUS];
+static unsigned mmu_nrollovers;
+
+/* Address space numbers; 0 is never used. */
+static struct spinlock mmu_idlock = SPINLOCK_INITIALIZER;
+static uint32_t mmu_nextid = 1;
+
+/*
+ * mmu_shootdown_lock allows one shootdown at a time, so each cpu
+ * has at most one pending and the shootdown queue never overflows
+ * (which would lose the ts_done wakeup). mmu_shootdown_sem collects
+ * the acknowledgements. The counters are also protected by the lock.
+ */
+static struct lock *mmu_shootdown_lock;
+static struct semaphore *mmu_shootdown_sem;
+static unsigned mmu_nshootdowns;	/* calls to mmu_shootdown */
+static unsigned mmu_nshootpages;	/* pages shot down */
+static unsigned mmu_nshootipis;		/* IPIs sent */
+
+void
+mmu_bootstrap(void)
+{
+	mmu_shootdown_lock = lock_create("mmu_shootdown");
+	if (mmu_shootdown_lock == NULL) {
+		panic("mmu_bootstrap: Out of memory\n");
+	}
+	mmu_shootdown_sem = sem_create("mmu_shootdown", 0);
+	if (mmu_shootdown_sem == NULL) {
+		panic("mmu_bootstrap: Out of memory\n");
+	}
+}
+
+void
+mmu_asinit(struct addrspace *as)
+{
+	spinlock_acquire(&mmu_idlock);
+	as->as_mmu.ma_id = mmu_nextid++;
+	if (mmu_nextid == 0) {
+		mmu_nextid = 1;
+	}
+	spinlock_release(&mmu_idlock);
+
+	bzero(as->as_mmu.ma_gen, sizeof(as->as_mmu.ma_gen));
+	bzero(as->as_mmu.ma_asid, sizeof(as->as_mmu.ma_asid));
+}
+
+/*
+ * Set EntryHi to the current ASID. Call at splhigh.
+ */
+static
+void
+mmu_setasid(void)
+{
+	/* Probing for page 0 loads EntryHi and has no other effect. */
+	tlb_probe(mmu_curasid[curcpu->c_number] << TLBHI_PIDSHIFT, 0);
+}
+
+/*
+ * Remove all translations from this cpu's TLB. Call at splhigh.
+ */
+static
+void
+mmu_tlbflush(void)
+{
+	int i;
+
+	for (i=0; i<NUM_TLB; i++) {
+		tlb_write(TLBHI_INVALID(i), TLBLO_INVALID(), i);
+	}
+	mmu_setasid();
+}
+
+/*
+ * Allocate this cpu's software TLB if it doesn't have one yet. Must
+ * be called with interrupts on, since it may need to kmalloc.
+ */
+static
+void
+mmu_cpuinit(void)
+{
+	struct mmu_cpu *mc;
+	int spl;
+
+	if (mmu_cpus[curcpu->c_number] != NULL) {
+		return;
+	}
+
+	mc = kmalloc(sizeof(*mc));
+	if (mc == NULL) {
+		/* Do without. */
+		return;
+	}
+	bzero(mc, sizeof(*mc));
+
+	/* We might have moved to another cpu while in kmalloc. */
+	spl = splhigh();
+	if (mmu_cpus[curcpu->c_number] == NULL) {
+		mmu_cpus[curcpu->c_number] = mc;
+		mc = NULL;
+	}
+	splx(spl);
+
+	if (mc != NULL) {
+		kfree(mc);
+	}
+}
+
+/*
+ * Load a translation into the TLB, replacing any existing entry for
+ * the same page, or else the next slot in round-robin order. Call at
+ * splhigh.
+ */
+static
+void
+mmu_tlbload(uint32_t ehi, uint32_t elo)
+{
+	unsigned *next;
+	int i;
+
+	i = tlb_probe(ehi, 0);
+	if (i < 0) {
+		next = &mmu_tlbnext[curcpu->c_number];
+		i = *next;
+		*next = (i + 1) % NUM_TLB;
+	}
+	tlb_write(ehi, elo, i);
+}
+
+/*
+ * Look up VPAGE of AS in this cpu's software TLB. Call at splhigh.
+ */
+static
+struct stlb_entry *
+mmu_stlbfind(struct mmu_cpu *mc, struct addrspace *as, uint32_t vpage)
+{
+	struct stlb_entry *se;
+
+	se = &mc->mc_stlb[STLB_HASH(as->as_mmu.ma_id, vpage)];
+	if (se->se_id == as->as_mmu.ma_id &&
+	    se->se_gen == as->as_mmu.ma_gen[curcpu->c_number] &&
+	    se->se_ehi == vpage) {
+		return se;
+	}
+	return NULL;
+}
+
+/*
+ * After a software TLB hit on VPAGE, also load whatever the software
+ * TLB has for the rest of its VM_PREFILLPAGES block that isn't in the
+ * TLB already, so that walking through the block takes one refill
+ * instead of several. Returns the number of entries loaded. Call at
+ * splhigh.
+ */
+static
+unsigned
+mmu_prefill(struct mmu_cpu *mc, struct addrspace *as, uint32_t vpage)
+{
+	struct stlb_entry *se;
+	uint32_t base, page, asid;
+	unsigned i, n;
+
+	asid = mmu_curasid[curcpu->c_number] << TLBHI_PIDSHIFT;
+	base = vpage & ~(uint32_t)(VM_PREFILLPAGES * PAGE_SIZE - 1);
+	n = 0;
+	for (i=0; i<VM_PREFILLPAGES; i++) {
+		page = base + i * PAGE_SIZE;
+		if (page == vpage) {
+			continue;
+		}
+		se = mmu_stlbfind(mc, as, page);
+		if (se == NULL || tlb_probe(page | asid, 0) >= 0) {
+			continue;
+		}
+		mmu_tlbload(page | asid, se->se_elo);
+		coremap_reference(se->se_elo & TLBLO_PPAGE);
+		n++;
+	}
+	return n;
+}
+
+void
+mmu_map(struct addrspace *as, vaddr_t vaddr, paddr_t paddr, bool writeable)
+{
+	struct mmu_cpu *mc;
+	struct stlb_entry *se;
+	uint32_t ehi, elo;
+	int spl;
+
+	elo = (paddr & TLBLO_PPAGE) | TLBLO_VALID;
+	if (writeable) {
+		elo |= TLBLO_DIRTY;
+	}
+
+	mmu_cpuinit();
+
+	spl = splhigh();
+
+	ehi = (vaddr & TLBHI_VPAGE) |
+		(mmu_curasid[curcpu->c_number] << TLBHI_PIDSHIFT);
+	mmu_tlbload(ehi, elo);
+	ehi &= TLBHI_VPAGE;
+	coremap_touch(paddr);
+
+	mc = mmu_cpus[curcpu->c_number];
+	if (mc != NULL) {
+		se = &mc->mc_stlb[STLB_HASH(as->as_mmu.ma_id, ehi)];
+		se->se_id = as->as_mmu.ma_id;
+		se->se_gen = as->as_mmu.ma_gen[curcpu->c_number];
+		se->se_ehi = ehi;
+		se->se_elo = elo;
+	}
+
+	splx(spl);
+}
+
+bool
+mmu_refill(struct addrspace *as, vaddr_t vaddr, int faulttype)
+{
+	struct mmu_cpu *mc;
+	struct stlb_entry *se;
+	uint32_t ehi;
+	bool hit;
+	int spl;
+
+	if (faulttype == VM_FAULT_READONLY) {
+		/* Needs a copy-on-write or permission check. */
+		return false;
+	}
+
+	ehi = vaddr & TLBHI_VPAGE;
+
+	spl = splhigh();
+
+	mc = mmu_cpus[curcpu->c_number];
+	if (mc == NULL) {
+		splx(spl);
+		return false;
+	}
+
+	se = mmu_stlbfind(mc, as, ehi);
+	hit = se != NULL &&
+		(faulttype == VM_FAULT_READ || (se->se_elo & TLBLO_DIRTY));
+
+	mc->mc_nlookups++;
+	if (hit) {
+		mc->mc_nhits++;
+		mmu_tlbload(ehi | (mmu_curasid[curcpu->c_number] <<
+				   TLBHI_PIDSHIFT), se->se_elo);
+		coremap_reference(se->se_elo & TLBLO_PPAGE);
+		mc->mc_nprefills += mmu_prefill(mc, as, ehi);
+	}
+
+	splx(spl);
+	return hit;
+}
+
+/*
+ * Remove any translation for VADDR in AS from this cpu's TLB and
+ * software TLB.
+ */
+static
+void
+mmu_unmap(struct addrspace *as, vaddr_t vaddr)
+{
+	struct mmu_cpu *mc;
+	struct stlb_entry *se;
+	uint32_t ehi, tag;
+	int i, spl;
+
+	ehi = vaddr & TLBHI_VPAGE;
+
+	spl = splhigh();
+
+	tag = as->as_mmu.ma_asid[curcpu->c_number];
+	if (tag != 0 && tag / NUM_TLBPID == mmu_asidgen[curcpu->c_number]) {
+		i = tlb_probe(ehi | ((tag % NUM_TLBPID) << TLBHI_PIDSHIFT), 0);
+		if (i >= 0) {
+			tlb_write(TLBHI_INVALID(i), TLBLO_INVALID(), i);
+		}
+		mmu_setasid();
+	}
+
+	mc = mmu_cpus[curcpu->c_number];
+	if (mc != NULL) {
+		se = &mc->mc_stlb[STLB_HASH(as->as_mmu.ma_id, ehi)];
+		if (se->se_id == as->as_mmu.ma_id && se->se_ehi == ehi) {
+			se->se_id = 0;
+		}
+	}
+
+	splx(spl);
+}
+
+void
+mmu_activate(struct addrspace *as)
+{
+	unsigned cpu;
+	uint32_t tag;
+	int spl;
+
+	spl = splhigh();
+	cpu = curcpu->c_number;
+
+	if (as == NULL) {
+		mmu_curasid[cpu] = 0;
+		mmu_setasid();
+		splx(spl);
+		return;
+	}
+
+	tag = as->as_mmu.ma_asid[cpu];
+	if (tag == 0 || tag / NUM_TLBPID != mmu_asidgen[cpu]) {
+		/* Need a new ASID. */
+		if (mmu_asidnext[cpu] == 0 || mmu_asidnext[cpu] == NUM_TLBPID) {
+			/* Out of ASIDs; start a new generation. */
+			mmu_asidgen[cpu]++;
+			mmu_asidnext[cpu] = 1;
+			mmu_nrollovers++;
+			mmu_tlbflush();
+		}
+		tag = mmu_asidgen[cpu] * NUM_TLBPID + mmu_asidnext[cpu]++;
+		as->as_mmu.ma_asid[cpu] = tag;
+	}
+
+	mmu_curasid[cpu] = tag % NUM_TLBPID;
+	mmu_setasid();
+
+	splx(spl);
+}
+
+/*
+ * Make AS's translations on cpu CPU unusable: give up its ASID there,
+ * which orphans its TLB entries, and bump its software TLB generation
+ * there, which does the same for its software TLB entries. This is
+ * safe without locking because AS is not running on CPU (or, if it
+ * is, CPU is this cpu and we're at splhigh), so nobody else is using
+ * these.
+ */
+static
+void
+mmu_disown(struct addrspace *as, unsigned cpu)
+{
+	as->as_mmu.ma_asid[cpu] = 0;
+	as->as_mmu.ma_gen[cpu]++;
+}
+
+void
+mmu_invalidate(struct addrspace *as, vaddr_t vaddr)
+{
+	unsigned cpu;
+	int spl;
+
+	/* Remove it here, and forget everything AS had anywhere else. */
+	spl = splhigh();
+	mmu_unmap(as, vaddr);
+	for (cpu=0; cpu<MAXCPUS; cpu++) {
+		if (cpu != curcpu->c_number) {
+			mmu_disown(as, cpu);
+		}
+	}
+	splx(spl);
+}
+
+void
+mmu_revoke(struct addrspace *as)
+{
+	unsigned cpu;
+	int spl;
+
+	spl = splhigh();
+	for (cpu=0; cpu<MAXCPUS; cpu++) {
+		mmu_disown(as, cpu);
+	}
+	splx(spl);
+
+	/* If it's running here, it needs a new ASID right away. */
+	if (as == curthread->t_addrspace) {
+		mmu_activate(as);
+	}
+}
+
+/*
+ * Check if PADDR is one of the NPAGES pages in PADDRS.
+ */
+static
+bool
+mmu_inbatch(paddr_t paddr, const paddr_t *paddrs, unsigned npages)
+{
+	unsigned i;
+
+	for (i=0; i<npages; i++) {
+		if (paddrs[i] == paddr) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Remove any translations for the physical pages in PADDRS from this
+ * cpu's TLB and software TLB, in one pass over each.
+ */
+static
+void
+mmu_unmap_paddrs(const paddr_t *paddrs, unsigned npages)
+{
+	struct mmu_cpu *mc;
+	uint32_t ehi, elo;
+	int i, spl;
+
+	spl = splhigh();
+
+	for (i=0; i<NUM_TLB; i++) {
+		tlb_read(&ehi, &elo, i);
+		if ((elo & TLBLO_VALID) &&
+		    mmu_inbatch(elo & TLBLO_PPAGE, paddrs, npages)) {
+			tlb_write(TLBHI_INVALID(i), TLBLO_INVALID(), i);
+		}
+	}
+	mmu_setasid();
+
+	mc = mmu_cpus[curcpu->c_number];
+	if (mc != NULL) {
+		for (i=0; i<STLB_SIZE; i++) {
+			if (mc->mc_stlb[i].se_id != 0 &&
+			    mmu_inbatch(mc->mc_stlb[i].se_elo & TLBLO_PPAGE,
+					paddrs, npages)) {
+				mc->mc_stlb[i].se_id = 0;
+			}
+		}
+	}
+
+	splx(spl);
+}
+
+void
+mmu_shootdown(const paddr_t *paddrs, unsigned npages, uint32_t cpumask)
+{
+	struct tlbshootdown ts;
+	unsigned i, n;
+	int spl;
+
+	KASSERT(npages > 0);
+
+	ts.ts_paddrs = paddrs;
+	ts.ts_npages = npages;
+	ts.ts_done = mmu_shootdown_sem;
+
+	lock_acquire(mmu_shootdown_lock);
+
+	/* Don't migrate between the local unmap and sending the IPIs. */
+	spl = splhigh();
+	mmu_unmap_paddrs(paddrs, npages);
+	n = ipi_tlbshootdown_cpus(cpumask, &ts);
+	splx(spl);
+
+	for (i=0; i<n; i++) {
+		P(mmu_shootdown_sem);
+	}
+
+	mmu_nshootdowns++;
+	mmu_nshootpages += npages;
+	mmu_nshootipis += n;
+
+	lock_release(mmu_shootdown_lock);
+}
+
+/*
+ * TLB shootdown handling called from interprocessor_interrupt.
+ */
+
+void
+vm_tlbshootdown_all(void)
+{
+	/* mmu_shootdown never lets the queue overflow. */
+	panic("vm_tlbshootdown_all: shootdown queue overflowed\n");
+}
+
+void
+vm_tlbshootdown(const struct tlbshootdown *ts)
+{
+	mmu_unmap_paddrs(ts->ts_paddrs, ts->ts_npages);
+	V(ts->ts_done);
+}
+
+void
+mmu_printstats(void)
+{
+	unsigned i, nlookups, nhits, nprefills;
+
+	nlookups = nhits = nprefills = 0;
+	for (i=0; i<MAXCPUS; i++) {
+		if (mmu_cpus[i] != NULL) {
+			nlookups += mmu_cpus[i]->mc_nlookups;
+			nhits += mmu_cpus[i]->mc_nhits;
+			nprefills += mmu_cpus[i]->mc_nprefills;
+		}
+	}
+	kprintf("mmu: software TLB: %u lookups, %u hits, %u prefills\n",
+		nlookups, nhits, nprefills);
+	kprintf("mmu: %u ASID rollovers\n", mmu_nrollovers);
+	kprintf("mmu: %u shootdowns of %u pages, %u IPIs\n",
+		mmu_nshootdowns, mmu_nshootpages, mmu_nshootipis);
+}
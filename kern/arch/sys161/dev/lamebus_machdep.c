@@ -73,6 +73,22 @@ mips_timer_set(uint32_t count)
 		:: "r" (count));
 }
 
+static
+uint32_t
+mips_timer_get(void)
+{
+	uint32_t count;
+
+	/* $9 == c0_count */
+	__asm volatile(
+		".set push;"		/* save assembler mode */
+		".set mips32;"		/* allow MIPS32 registers */
+		"mfc0 %0, $9;"		/* do it */
+		".set pop"		/* restore assembler mode */
+		: "=r" (count));
+	return count;
+}
+
 /*
  * LAMEbus data for the system. (We have only one LAMEbus per system.)
  * This does not need to be locked, because it's constant once
@@ -242,6 +258,23 @@ mainbus_send_ipi(struct cpu *target)
 	lamebus_assert_ipi(lamebus, target);
 }
 
+/*
+ * Set the on-chip timer to go off NTICKS hardclock periods from now.
+ * Writing the compare register restarts the count, so this works
+ * both from the timer interrupt and from elsewhere, and the count
+ * beforehand says how long ago the timer was last set.
+ */
+unsigned
+mainbus_settimer(unsigned nticks)
+{
+	unsigned elapsed;
+
+	KASSERT(nticks > 0 && nticks <= HZ);
+	elapsed = mips_timer_get() / (CPU_FREQUENCY / HZ);
+	mips_timer_set(nticks * (CPU_FREQUENCY / HZ));
+	return elapsed;
+}
+
 /*
  * Interrupt dispatcher.
  */
@@ -268,9 +301,12 @@ mainbus_interrupt(struct trapframe *tf)
 		lamebus_clear_ipi(lamebus, curcpu);
 	}
 	else if (cause & MIPS_TIMER_BIT) {
-		/* Reset the timer (this clears the interrupt) */
+		/*
+		 * Reset the timer (this clears the interrupt) and
+		 * call hardclock, which may push the next interrupt
+		 * further out.
+		 */
 		mips_timer_set(CPU_FREQUENCY / HZ);
-		/* and call hardclock */
 		hardclock();
 	}
 	else {
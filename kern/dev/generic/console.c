@@ -194,6 +194,7 @@ con_input(void *vcs, int ch)
 	cs->cs_gotchars_head = nexthead;
 		
 	V(cs->cs_rsem);
+	pollqueue_wake(&cs->cs_pollq);
 }
 
 /*
@@ -360,6 +361,26 @@ con_ioctl(struct device *dev, int op, userptr_t data)
 	return EINVAL;
 }
 
+/*
+ * Input is ready if con_input has put characters in the buffer that
+ * nobody has taken out yet. Output never waits for long, so we always
+ * call it ready.
+ */
+static
+int
+con_poll(struct device *dev, int events, int *revents, struct pollwait *pw)
+{
+	struct con_softc *cs = dev->d_data;
+
+	pollwait_register(pw, &cs->cs_pollq);
+
+	*revents = events & POLLOUT;
+	if (cs->cs_gotchars_head != cs->cs_gotchars_tail) {
+		*revents |= events & POLLIN;
+	}
+	return 0;
+}
+
 static
 int
 attach_console_to_vfs(struct con_softc *cs)
@@ -376,6 +397,7 @@ attach_console_to_vfs(struct con_softc *cs)
 	dev->d_close = con_close;
 	dev->d_io = con_io;
 	dev->d_ioctl = con_ioctl;
+	dev->d_poll = con_poll;
 	dev->d_blocks = 0;
 	dev->d_blocksize = 1;
 	dev->d_data = cs;
@@ -441,6 +463,7 @@ config_con(struct con_softc *cs, int unit)
 	cs->cs_wsem = wsem; 
 	cs->cs_gotchars_head = 0;
 	cs->cs_gotchars_tail = 0;
+	pollqueue_init(&cs->cs_pollq);
 
 	the_console = cs;
 	con_userlock_read = rlk;
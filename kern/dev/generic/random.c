@@ -32,6 +32,7 @@
 #include <kern/fcntl.h>
 #include <lib.h>
 #include <uio.h>
+#include <poll.h>
 #include <vfs.h>
 #include <generic/random.h>
 #include "autoconf.h"
@@ -109,6 +110,19 @@ randioctl(struct device *dev, int op, userptr_t data)
 	return EIOCTL;
 }
 
+/*
+ * VFS poll function. Random numbers are always available.
+ */
+static
+int
+randpoll(struct device *dev, int events, int *revents, struct pollwait *pw)
+{
+	(void)dev;
+	(void)pw;
+	*revents = events & (POLLIN | POLLOUT);
+	return 0;
+}
+
 /*
  * Config function.
  */
@@ -129,6 +143,7 @@ config_random(struct random_softc *rs, int unit)
 	rs->rs_dev.d_close = randclose;
 	rs->rs_dev.d_io = randio;
 	rs->rs_dev.d_ioctl = randioctl;
+	rs->rs_dev.d_poll = randpoll;
 	rs->rs_dev.d_blocks = 0;
 	rs->rs_dev.d_blocksize = 1;
 	rs->rs_dev.d_data = rs;
@@ -47,6 +47,7 @@
 #include <lib.h>
 #include <array.h>
 #include <uio.h>
+#include <poll.h>
 #include <synch.h>
 #include <lamebus/emu.h>
 #include <platform/bus.h>
@@ -629,6 +630,22 @@ emufs_ioctl(struct vnode *v, int op, userptr_t data)
 	return EINVAL;
 }
 
+/*
+ * VOP_POLL
+ *
+ * Files on the host are always ready.
+ */
+static
+int
+emufs_poll(struct vnode *v, int events, int *revents, struct pollwait *pw)
+{
+	(void)v;
+	(void)pw;
+
+	*revents = events & (POLLIN | POLLOUT);
+	return 0;
+}
+
 /*
  * VOP_STAT
  */
@@ -837,13 +854,16 @@ emufs_namefile(struct vnode *v, struct uio *uio)
 
 /*
  * VOP_MMAP
+ *
+ * Files can be mapped; the VM system reads and writes them with
+ * VOP_READ and VOP_WRITE.
  */
 static
 int
 emufs_mmap(struct vnode *v)
 {
 	(void)v;
-	return EUNIMP;
+	return 0;
 }
 
 //////////////////////////////
@@ -1085,6 +1105,7 @@ static const struct vnode_ops emufs_fileops = {
 	emufs_uio_op_notdir, /* getdirentry */
 	emufs_write,
 	emufs_ioctl,
+	emufs_poll,
 	emufs_stat,
 	emufs_file_gettype,
 	emufs_tryseek,
@@ -1120,6 +1141,7 @@ static const struct vnode_ops emufs_dirops = {
 	emufs_getdirentry,
 	emufs_uio_op_isdir,   /* write */
 	emufs_ioctl,
+	emufs_poll,
 	emufs_stat,
 	emufs_dir_gettype,
 	emufs_dir_tryseek,
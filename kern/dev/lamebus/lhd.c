@@ -35,6 +35,7 @@
 #include <kern/errno.h>
 #include <lib.h>
 #include <uio.h>
+#include <poll.h>
 #include <synch.h>
 #include <platform/bus.h>
 #include <vfs.h>
@@ -179,6 +180,19 @@ lhd_ioctl(struct device *d, int op, userptr_t data)
 	return EIOCTL;
 }
 
+/*
+ * Function for poll/select. The disk never makes anyone wait.
+ */
+static
+int
+lhd_poll(struct device *d, int events, int *revents, struct pollwait *pw)
+{
+	(void)d;
+	(void)pw;
+	*revents = events & (POLLIN | POLLOUT);
+	return 0;
+}
+
 #if 0
 /*
  * Reset the device.
@@ -306,6 +320,7 @@ config_lhd(struct lhd_softc *lh, int lhdno)
 	lh->lh_dev.d_close = lhd_close;
 	lh->lh_dev.d_io = lhd_io;
 	lh->lh_dev.d_ioctl = lhd_ioctl;
+	lh->lh_dev.d_poll = lhd_poll;
 	lh->lh_dev.d_blocks = bus_read_register(lh->lh_busdata, lh->lh_buspos,
 						LHD_REG_NSECT);
 	lh->lh_dev.d_blocksize = LHD_SECTSIZE;
@@ -34,6 +34,7 @@
 #include <lib.h>
 #include <spl.h>
 #include <clock.h>
+#include <timeout.h>
 #include <platform/bus.h>
 #include <lamebus/ltimer.h>
 #include "autoconf.h"
@@ -46,11 +47,21 @@
 #define LT_REG_COUNT  16    /* Time for countdown timer (usec) */
 #define LT_REG_SPKR   20    /* Beep control */
 
-/* Granularity of countdown timer (usec) */
-#define LT_GRANULARITY   1000000
-
 static bool havetimerclock;
 
+/*
+ * Set the countdown timer to go off once, USECS microseconds from
+ * now. Called by the timeout code.
+ */
+static
+void
+ltimer_settimer(void *vlt, uint32_t usecs)
+{
+	struct ltimer_softc *lt = vlt;
+
+	bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_COUNT, usecs);
+}
+
 /*
  * Setup routine called by autoconf stuff when an ltimer is found.
  */
@@ -91,10 +102,13 @@ config_ltimer(struct ltimer_softc *lt, int ltimerno)
 		havetimerclock = true;
 		lt->lt_timerclock = 1;
 
-		/* Wire it to go off once every second. */
-		bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_ROE, 1);
-		bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_COUNT,
-				   LT_GRANULARITY);
+		/*
+		 * Run it one-shot, and let the timeout code set it
+		 * for the next deadline each time; that's never more
+		 * than a second away.
+		 */
+		bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_ROE, 0);
+		timeout_setdevice(ltimer_settimer, lt);
 	}
 	
 	return 0;
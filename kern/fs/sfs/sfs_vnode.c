@@ -40,6 +40,7 @@
 #include <array.h>
 #include <bitmap.h>
 #include <uio.h>
+#include <poll.h>
 #include <synch.h>
 #include <vfs.h>
 #include <device.h>
@@ -1015,6 +1016,20 @@ sfs_ioctl(struct vnode *v, int op, userptr_t data)
 	return EINVAL;
 }
 
+/*
+ * Called for poll() and select(). Files on disk are always ready.
+ */
+static
+int
+sfs_poll(struct vnode *v, int events, int *revents, struct pollwait *pw)
+{
+	(void)v;
+	(void)pw;
+
+	*revents = events & (POLLIN | POLLOUT);
+	return 0;
+}
+
 /*
  * Called for stat/fstat/lstat.
  */
@@ -1110,14 +1125,15 @@ sfs_fsync(struct vnode *v)
 }
 
 /*
- * Called for mmap().
+ * Called for mmap(). Files can be mapped; the VM system does the
+ * rest with VOP_READ and VOP_WRITE. (Directories use sfs_isdir.)
  */
 static
 int
-sfs_mmap(struct vnode *v   /* add stuff as needed */)
+sfs_mmap(struct vnode *v)
 {
 	(void)v;
-	return EUNIMP;
+	return 0;
 }
 
 /*
@@ -1587,6 +1603,7 @@ static const struct vnode_ops sfs_fileops = {
 	NOTDIR,  /* getdirentry */
 	sfs_write,
 	sfs_ioctl,
+	sfs_poll,
 	sfs_stat,
 	sfs_gettype,
 	sfs_tryseek,
@@ -1622,6 +1639,7 @@ static const struct vnode_ops sfs_dirops = {
 	UNIMP,   /* getdirentry */
 	ISDIR,   /* write */
 	sfs_ioctl,
+	sfs_poll,
 	sfs_stat,
 	sfs_gettype,
 	UNIMP,   /* tryseek */
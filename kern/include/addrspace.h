@@ -36,9 +36,58 @@
 
 
 #include <vm.h>
+#include <array.h>
 #include "opt-dumbvm.h"
 
 struct vnode;
+struct pagetable;
+struct pcfile;
+
+#if !OPT_DUMBVM
+/*
+ * Region - a contiguous range of virtual pages in an address space
+ * with uniform permissions. Created by as_define_region and
+ * as_define_segment (for program segments), as_define_stack, and
+ * as_mmap.
+ *
+ * A region may be backed by a file: RG_FILESIZE bytes of RG_VNODE,
+ * starting at offset RG_FILEOFFSET, appear at (possibly unaligned)
+ * address RG_FILEVADDR, and pages are read in from the file when
+ * first touched. Everything else in the region is zero-filled.
+ * Pages of read-only file-backed regions are shared between address
+ * spaces through the page cache (RG_PCFILE), as are the pages of
+ * shared mappings (RG_SHARED), which are never copy-on-write.
+ *
+ * A shared mapping of a file that isn't open for writing has
+ * RG_MAXWRITE clear, so mprotect can't make it writeable.
+ *
+ * A fault in the region also maps whatever neighbouring pages are
+ * already resident, within an aligned window of RG_FAULTAROUND pages.
+ */
+struct region {
+	vaddr_t rg_base;		/* first address, page-aligned */
+	size_t rg_npages;		/* length in pages */
+	bool rg_readable;
+	bool rg_writeable;
+	bool rg_executable;
+	struct vnode *rg_vnode;		/* backing file, or NULL */
+	off_t rg_fileoffset;		/* offset of image in file */
+	vaddr_t rg_filevaddr;		/* where the image starts */
+	size_t rg_filesize;		/* length of image */
+	struct pcfile *rg_pcfile;	/* page cache handle, or NULL */
+	bool rg_mapped;			/* created by mmap */
+	bool rg_shared;			/* MAP_SHARED */
+	bool rg_maxwrite;		/* may be made writeable */
+	unsigned rg_faultaround;	/* fault-around window, in pages */
+};
+
+#ifndef ADDRSPACEINLINE
+#define ADDRSPACEINLINE INLINE
+#endif
+
+DECLARRAY(region);
+DEFARRAY(region, ADDRSPACEINLINE);
+#endif
 
 
 /* 
@@ -58,7 +107,19 @@ struct addrspace {
         size_t as_npages2;
         paddr_t as_stackpbase;
 #else
-        /* Put stuff here for your VM system */
+        struct regionarray as_regions;	/* defined regions */
+        struct pagetable *as_pt;	/* vaddr -> lpage mappings */
+        bool as_loading;		/* true between prepare/complete_load */
+        struct region *as_heap;		/* heap region (in as_regions) */
+        vaddr_t as_heapend;		/* current end of heap (break) */
+        struct region *as_stack;	/* stack region (in as_regions) */
+        size_t as_stackpages;		/* limit on stack size */
+        struct mmu_as as_mmu;		/* MD MMU state */
+        unsigned as_ntlbmisses;		/* TLB misses (not counting
+					   VM_FAULT_READONLY) */
+        unsigned as_ntlbrefills;	/* ...handled by mmu_refill */
+        unsigned as_nfaults;		/* faults handled by vm_fault */
+        unsigned as_nprefills;		/* neighbours mapped by vm_fault */
 #endif
 };
 
@@ -94,6 +155,68 @@ struct addrspace {
  *    as_define_stack - set up the stack region in the address space.
  *                (Normally called *after* as_complete_load().) Hands
  *                back the initial stack pointer for the new process.
+ *
+ *    as_define_segment - like as_define_region, but the first FILESIZE
+ *                bytes of the segment come from file V at OFFSET.
+ *                They are read in a page at a time as the program
+ *                touches them. (Not available under dumbvm.)
+ *
+ *    as_findregion - return the region containing VADDR, or NULL if
+ *                there isn't one. (Not available under dumbvm.)
+ *
+ *    as_growstack - if VADDR is below the stack but within its limit,
+ *                grow the stack down to include it and return the
+ *                stack region; otherwise return NULL. (Not available
+ *                under dumbvm.)
+ *
+ *    as_setstacklimit - set the stack size limit, in pages, for
+ *                address spaces created from now on. (Not available
+ *                under dumbvm.)
+ *
+ *    as_setfaultaround - set the default fault-around window, in
+ *                pages, for regions created from now on; as_madvise
+ *                changes it for existing ones. NPAGES must be a power
+ *                of 2 no larger than VM_FAULTAROUNDMAX. (Not
+ *                available under dumbvm.)
+ *
+ *    as_loadpage - read the part of a file-backed region's image that
+ *                falls in the page at VADDR into physical page PADDR,
+ *                which must already be zeroed. (Not available under
+ *                dumbvm.)
+ *
+ *    as_sbrk   - move the end of the heap by AMOUNT bytes and hand back
+ *                the old end. The heap starts out empty just above the
+ *                highest segment. Returns EINVAL if that would leave
+ *                it with negative size, ENOMEM if it would run into
+ *                another region. (Not available under dumbvm.)
+ *
+ *    as_mmap   - map LEN bytes of file V (or zeros, if V is NULL) at
+ *                OFFSET into the address space, at ADDR if MAP_FIXED
+ *                is given or wherever there is room below the stack
+ *                otherwise, and hand back the address chosen. PROT
+ *                and FLAGS are as for mmap. CANWRITE says whether V
+ *                is open for writing; if not, a shared mapping can't
+ *                be writeable, now or later. (Not available under
+ *                dumbvm.)
+ *
+ *    as_munmap - remove mappings made by as_mmap from [ADDR, ADDR+LEN),
+ *                writing changes to shared mappings back to the file.
+ *                If that fails, returns the error and unmaps nothing.
+ *                (Not available under dumbvm.)
+ *
+ *    as_mprotect - change the permissions of the mappings made by
+ *                as_mmap in [ADDR, ADDR+LEN), all of which must be
+ *                mapped. Returns EACCES if asked to make writeable a
+ *                shared mapping of a file not open for writing. (Not
+ *                available under dumbvm.)
+ *
+ *    as_madvise - set the fault-around window of the regions in
+ *                [ADDR, ADDR+LEN), all of which must be mapped by
+ *                as_mmap, from ADVICE (one of the MADV_ constants).
+ *                (Not available under dumbvm.)
+ *
+ *    as_printstats - print the TLB miss and fault counts of all
+ *                address spaces destroyed so far. (Not available under dumbvm.)
  */
 
 struct addrspace *as_create(void);
@@ -110,6 +233,33 @@ int               as_prepare_load(struct addrspace *as);
 int               as_complete_load(struct addrspace *as);
 int               as_define_stack(struct addrspace *as, vaddr_t *initstackptr);
 
+#if !OPT_DUMBVM
+int               as_define_segment(struct addrspace *as,
+                                    vaddr_t vaddr, size_t memsize,
+                                    struct vnode *v, off_t offset,
+                                    size_t filesize,
+                                    int readable,
+                                    int writeable,
+                                    int executable);
+struct region    *as_findregion(struct addrspace *as, vaddr_t vaddr);
+struct region    *as_growstack(struct addrspace *as, vaddr_t vaddr);
+int               as_setstacklimit(size_t npages);
+int               as_setfaultaround(unsigned npages);
+int               as_loadpage(struct region *reg, vaddr_t vaddr,
+                              paddr_t paddr);
+int               as_sbrk(struct addrspace *as, intptr_t amount,
+                          vaddr_t *oldend);
+int               as_mmap(struct addrspace *as, vaddr_t addr, size_t len,
+                          int prot, int flags, struct vnode *v,
+                          off_t offset, bool canwrite, vaddr_t *ret);
+int               as_munmap(struct addrspace *as, vaddr_t addr, size_t len);
+int               as_mprotect(struct addrspace *as, vaddr_t addr,
+                              size_t len, int prot);
+int               as_madvise(struct addrspace *as, vaddr_t addr,
+                             size_t len, int advice);
+void              as_printstats(void);
+#endif
+
 
 /*
  * Functions in loadelf.c
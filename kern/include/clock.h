@@ -30,20 +30,26 @@
 #ifndef _CLOCK_H_
 #define _CLOCK_H_
 
+#include <kern/time.h>
 #include "opt-synchprobs.h"
 
 /*
  * Time-related definitions.
  *
- * hardclock() is called on every CPU HZ times a second, possibly only
- * when the CPU is not idle, for scheduling.
+ * hardclock() is called on every CPU up to HZ times a second, for
+ * scheduling. A CPU that is idle, or has only one thread to run,
+ * skips ticks it doesn't need.
  *
- * timerclock() is called on one CPU once a second to allow simple
- * timed operations. (This is a fairly simpleminded interface.)
+ * timerclock() is called on one CPU at least once a second, and
+ * whenever a timeout (see <timeout.h>) is due.
  *
  * gettime() may be used to fetch the current time of day.
  * getinterval() computes the time from time1 to time2.
  *
+ * getdeadline() computes the time SECS and NSECS from now, for timed
+ * sleeps, which take absolute deadlines. timespec_cmp() compares two
+ * times like strcmp.
+ *
  * XXX we have struct timespec now, let's use it.
  */
 
@@ -56,6 +62,10 @@
 #define HZ  100
 #endif
 
+/* How far a cpu's timer may be stretched, in hardclocks (see thread.c) */
+#define IDLE_HARDCLOCKS		HZ	/* Tick once a second when idle. */
+#define ALONE_HARDCLOCKS	10	/* Stretch to 10 with one thread. */
+
 void hardclock_bootstrap(void);
 
 void hardclock(void);
@@ -67,11 +77,18 @@ void getinterval(time_t secs1, uint32_t nsecs,
                  time_t secs2, uint32_t nsecs2,
                  time_t *rsecs, uint32_t *rnsecs);
 
+void getdeadline(time_t secs, uint32_t nsecs, struct timespec *deadline);
+int timespec_cmp(const struct timespec *a, const struct timespec *b);
+
 /*
  * clocksleep() suspends execution for the requested number of seconds,
  * like userlevel sleep(3). (Don't confuse it with wchan_sleep.)
+ *
+ * clocksleep_until() suspends execution until DEADLINE, with much
+ * finer resolution.
  */
 void clocksleep(int seconds);
+void clocksleep_until(const struct timespec *deadline);
 
 
 #endif /* _CLOCK_H_ */
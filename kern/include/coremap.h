@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _COREMAP_H_
+#define _COREMAP_H_
+
+#include <vm.h>
+
+/*
+ * Coremap: the physical page allocator.
+ *
+ * The coremap has one entry for every physical page handed to the VM
+ * system by ram_getsize(). Free pages are kept on a doubly-linked
+ * free list so that single-page allocation and freeing are constant
+ * time; multi-page kernel allocations search for a run of free
+ * pages and unlink them individually.
+ *
+ * Pages allocated before coremap_bootstrap (by early kmalloc calls)
+ * come from ram_stealmem and are never returned.
+ *
+ * When memory runs out, single-page allocations evict a user page to
+ * swap, as chosen by the current eviction policy ("clock" by default,
+ * or "random").
+ *
+ * The coremap implements alloc_kpages, free_kpages, page_alloc,
+ * page_alloczero, and page_free (see vm.h). In addition:
+ *
+ *    coremap_bootstrap  - set up the coremap. Called from vm_bootstrap.
+ *    coremap_setpolicy  - select an eviction policy by name. Returns
+ *                         EINVAL if there is no such policy.
+ *    coremap_touch      - note that a user page has been mapped on
+ *                         this cpu.
+ *    coremap_reference  - note that a user page already mapped on this
+ *                         cpu has been used again.
+ *    coremap_shootdown  - remove every translation for a user page.
+ *                         The caller must hold its lpage lock.
+ *    coremap_prezero    - zero a few free pages ahead of time for
+ *                         page_alloczero. Called from vm_idle.
+ *    coremap_printstats - print page counts by state.
+ */
+
+void coremap_bootstrap(void);
+int coremap_setpolicy(const char *name);
+void coremap_touch(paddr_t paddr);
+void coremap_reference(paddr_t paddr);
+void coremap_shootdown(paddr_t paddr);
+void coremap_prezero(void);
+void coremap_printstats(void);
+
+
+#endif /* _COREMAP_H_ */
@@ -35,6 +35,9 @@
 #include <threadlist.h>
 #include <machine/vm.h>  /* for TLBSHOOTDOWN_MAX */
 
+/* Number of priority levels in the run queue; 0 is the highest. */
+#define RUNQUEUE_NLEVELS 4
+
 
 /*
  * Per-cpu structure
@@ -59,14 +62,18 @@ struct cpu {
 	 */
 	struct thread *c_curthread;	/* Current thread on cpu */
 	struct threadlist c_zombies;	/* List of exited threads */
+	struct threadlist c_threadcache; /* Dead threads kept for reuse */
 	unsigned c_hardclocks;		/* Counter of hardclock() calls */
+	uint32_t c_stealseed;		/* Random state for work stealing */
 
 	/*
 	 * Accessed by other cpus.
 	 * Protected by the runqueue lock.
 	 */
 	bool c_isidle;			/* True if this cpu is idle */
-	struct threadlist c_runqueue;	/* Run queue for this cpu */
+	unsigned c_timerticks;		/* Hardclocks the timer is set for */
+	struct threadlist c_runqueue[RUNQUEUE_NLEVELS]; /* Run queue, by
+							   priority */
 	struct spinlock c_runqueue_lock;
 
 	/*
@@ -152,6 +159,10 @@ void cpu_halt(void);
  * ipi_send sends an IPI to one CPU.
  * ipi_broadcast sends an IPI to all CPUs except the current one.
  * ipi_tlbshootdown is like ipi_send but carries TLB shootdown data.
+ * ipi_tlbshootdown_cpus sends a TLB shootdown to each CPU whose bit
+ * (1 << c_number) is set in CPUMASK, except the current one, and
+ * returns the number of CPUs it was sent to. CPUs numbered 32 and up
+ * always get it.
  *
  * interprocessor_interrupt is called on the target CPU when an IPI is
  * received.
@@ -166,6 +177,8 @@ void cpu_halt(void);
 void ipi_send(struct cpu *target, int code);
 void ipi_broadcast(int code);
 void ipi_tlbshootdown(struct cpu *target, const struct tlbshootdown *mapping);
+unsigned ipi_tlbshootdown_cpus(uint32_t cpumask,
+			      const struct tlbshootdown *mapping);
 
 void interprocessor_interrupt(void);
 
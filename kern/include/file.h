@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _FILE_H_
+#define _FILE_H_
+
+/*
+ * Open files and per-process file tables.
+ *
+ * An openfile is what one call to open() creates: a vnode, the mode
+ * it was opened with, and a seek position. File descriptors are
+ * indexes into the process's filetable, whose slots point at
+ * openfiles. dup2 and fork make several slots, in one process or
+ * several, share one openfile and thus one seek position, so
+ * openfiles are reference counted and the vnode is closed when the
+ * last reference goes away.
+ *
+ * Locking: of_countlock protects of_refcount. of_lock protects
+ * of_offset and is held across I/O on seekable files, so that reads
+ * and writes through one openfile each see and advance the offset
+ * atomically. Nonseekable files (the console) have no offset and are
+ * not locked at all. Separate openfiles never contend with each
+ * other. A filetable belongs to one single-threaded process and
+ * needs no lock of its own.
+ */
+
+#include <limits.h>
+#include <spinlock.h>
+
+struct vnode;
+struct lock;
+
+struct openfile {
+	struct vnode *of_vnode;		/* the file (holds a vfs_open ref) */
+	int of_accmode;			/* O_RDONLY, O_WRONLY, or O_RDWR */
+	bool of_append;			/* O_APPEND */
+	bool of_seekable;		/* whether of_offset is used */
+	struct lock *of_lock;		/* protects of_offset */
+	off_t of_offset;		/* seek position */
+	struct spinlock of_countlock;	/* protects of_refcount */
+	unsigned of_refcount;		/* filetable slots using it */
+};
+
+struct filetable {
+	struct openfile *ft_files[OPEN_MAX];	/* NULL if fd is free */
+};
+
+/*
+ * Functions:
+ *
+ *    openfile_create  - make a new openfile with one reference for
+ *                       V, which must already be open (as by
+ *                       vfs_open) with the access mode in FLAGS.
+ *                       Takes over the caller's vnode reference,
+ *                       unless it fails.
+ *    openfile_open    - open PATH with FLAGS and MODE as per open(),
+ *                       and hand back a new openfile with one
+ *                       reference. May destroy PATH.
+ *    openfile_incref  - add a reference.
+ *    openfile_decref  - drop a reference; the last one closes the
+ *                       file.
+ *
+ *    filetable_create  - create an empty file table. Returns NULL if
+ *                        out of memory.
+ *    filetable_destroy - drop every file in FT and free it.
+ *    filetable_copy    - make a new file table sharing all the
+ *                        openfiles of SRC, for fork.
+ *    filetable_get     - look up FD, returning EBADF if it isn't open.
+ *                        No reference is added; the openfile stays
+ *                        valid as long as the caller doesn't close FD.
+ *    filetable_place   - put OF in the lowest free slot and return the
+ *                        fd, or EMFILE if there is none. Takes over
+ *                        the caller's reference.
+ *    filetable_set     - put OF (which may be NULL) in slot FD,
+ *                        closing whatever was there. Takes over the
+ *                        caller's reference. FD must be valid.
+ *    filetable_openconsole - open the console as fds 0, 1, and 2 of a
+ *                        new process.
+ */
+int openfile_create(struct vnode *v, int flags, struct openfile **ret);
+int openfile_open(char *path, int flags, mode_t mode, struct openfile **ret);
+void openfile_incref(struct openfile *of);
+void openfile_decref(struct openfile *of);
+
+struct filetable *filetable_create(void);
+void filetable_destroy(struct filetable *ft);
+int filetable_copy(struct filetable *src, struct filetable **ret);
+int filetable_get(struct filetable *ft, int fd, struct openfile **ret);
+int filetable_place(struct filetable *ft, struct openfile *of, int *fd);
+void filetable_set(struct filetable *ft, int fd, struct openfile *of);
+int filetable_openconsole(struct filetable *ft);
+
+
+#endif /* _FILE_H_ */
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _LPAGE_H_
+#define _LPAGE_H_
+
+/*
+ * Logical page: one page of user memory, independent of where (or
+ * whether) it currently lives in physical memory. Page tables point
+ * at lpages rather than at physical pages.
+ *
+ * An lpage may be shared by several address spaces after fork. A
+ * shared lpage is copy-on-write: it is mapped read-only everywhere,
+ * and the first write to it through any address space makes a private
+ * copy for that address space.
+ *
+ * An lpage is either resident (lp_paddr is set) or paged out to swap
+ * (lp_swapslot is set); a resident page may also still have a clean
+ * copy in swap.
+ *
+ * Pages in the page cache also belong to a file. lp_filedirty says
+ * whether such a page has been written through a shared mapping since
+ * it was read from or written back to the file.
+ *
+ * Locking: lp_refcount is protected by lp_lock. Everything else is
+ * protected by the lpage lock (lpage_lock/lpage_unlock), a sleeping
+ * lock built from the lp_busy flag. The page fault code holds it
+ * while making a page resident and mapping it; the pageout code holds
+ * it while writing a page to swap. The pageout code only ever uses
+ * lpage_trylock, so that it cannot block on a page held by a thread
+ * that is itself waiting for memory.
+ */
+
+#include <spinlock.h>
+#include <vm.h>
+
+struct vnode;
+
+struct lpage {
+	struct spinlock lp_lock;	/* protects lp_refcount, lp_busy */
+	unsigned lp_refcount;		/* number of page tables using it */
+	bool lp_busy;			/* lpage lock is held */
+	bool lp_dirty;			/* changed since read from swap */
+	bool lp_filedirty;		/* changed since read from file */
+	paddr_t lp_paddr;		/* physical page, or 0 */
+	unsigned lp_swapslot;		/* swap slot, or SWAP_NOSLOT */
+};
+
+/*
+ * Functions:
+ *
+ *    lpage_bootstrap - initialize. Called from vm_bootstrap.
+ *    lpage_lock      - acquire the lpage lock, sleeping if necessary.
+ *    lpage_trylock   - acquire the lpage lock if it is free. Does not
+ *                      sleep; may be called with spinlocks held.
+ *    lpage_unlock    - release the lpage lock.
+ *    lpage_zerofill  - create a new lpage backed by a fresh zeroed
+ *                      physical page. Hands back the lpage, locked,
+ *                      and the physical address. Returns ENOMEM on
+ *                      failure.
+ *    lpage_copy      - create a new lpage with the same contents as
+ *                      an existing one, which must be locked and
+ *                      resident. Hands back the new lpage, locked,
+ *                      and its physical address.
+ *    lpage_pagein    - make a locked lpage resident, reading it from
+ *                      swap if necessary, and hand back its physical
+ *                      address.
+ *    lpage_evict     - write a locked, resident lpage out to swap
+ *                      and detach it from its physical page, which
+ *                      the caller then owns. The caller must first
+ *                      remove all translations for the page with
+ *                      mmu_shootdown, so it can't change while being
+ *                      written.
+ *    lpage_markdirty - note that a locked lpage is about to be
+ *                      mapped writeable.
+ *    lpage_writeback - if a locked lpage has been changed since it was
+ *                      read from its file, write bytes LO through HI
+ *                      of it back to file V at OFFSET+LO. Removes all
+ *                      translations for the page first, so further
+ *                      writes fault and dirty it again.
+ *    lpage_incref    - add a reference to an lpage (share it).
+ *    lpage_decref    - drop a reference; the last one releases the
+ *                      lpage, its physical page, and its swap slot.
+ *                      Must not be called with the lpage locked.
+ *    lpage_isshared  - check if more than one page table refers to
+ *                      an lpage, i.e., if it is copy-on-write.
+ */
+void lpage_bootstrap(void);
+void lpage_lock(struct lpage *lp);
+bool lpage_trylock(struct lpage *lp);
+void lpage_unlock(struct lpage *lp);
+int lpage_zerofill(struct lpage **lpret, paddr_t *paddrret);
+int lpage_copy(struct lpage *old, struct lpage **lpret, paddr_t *paddrret);
+int lpage_pagein(struct lpage *lp, paddr_t *paddrret);
+int lpage_evict(struct lpage *lp);
+void lpage_markdirty(struct lpage *lp);
+int lpage_writeback(struct lpage *lp, struct vnode *v, off_t offset,
+		    unsigned lo, unsigned hi);
+void lpage_incref(struct lpage *lp);
+void lpage_decref(struct lpage *lp);
+bool lpage_isshared(struct lpage *lp);
+
+
+#endif /* _LPAGE_H_ */
@@ -55,6 +55,13 @@ size_t mainbus_ramsize(void);
 /* Switch on an inter-processor interrupt. (Low-level.) */
 void mainbus_send_ipi(struct cpu *target);
 
+/*
+ * Set the current cpu's next hardclock for NTICKS 1/HZ ticks from now.
+ * Returns how many whole ticks had gone by since the timer was last
+ * set.
+ */
+unsigned mainbus_settimer(unsigned nticks);
+
 /*
  * The various ways to shut down the system. (These are very low-level
  * and should generally not be called directly - md_poweroff, for
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _PAGECACHE_H_
+#define _PAGECACHE_H_
+
+/*
+ * Page cache for read-only file-backed regions, so that processes
+ * running the same program share one copy of its text, and for
+ * shared file mappings (mmap with MAP_SHARED), so that every process
+ * mapping a file sees the same pages.
+ *
+ * Pages are keyed by (vnode, file offset). The cache holds a
+ * reference to each page it contains, so every mapping of a cached
+ * page sees it as shared and thus copy-on-write. A vnode's pages stay
+ * cached as long as some region is attached to it; when the last one
+ * goes away (the last process running the program exits) they are
+ * released, after writing back any that were changed through a
+ * shared mapping.
+ *
+ * Functions:
+ *
+ *    pagecache_bootstrap  - initialize. Called from vm_bootstrap.
+ *    pagecache_attach     - start caching pages of V for a region.
+ *                           Returns NULL if out of memory, in which
+ *                           case the region just doesn't share.
+ *    pagecache_detach     - undo pagecache_attach. Writes back dirty
+ *                           pages if this was the last user.
+ *    pagecache_getpage    - find or read in the page at VADDR of
+ *                           file-backed region REG, which is attached
+ *                           to PF. Hands back the lpage, locked and
+ *                           resident, with a reference added for the
+ *                           caller's page table, and its physical
+ *                           address.
+ *    pagecache_peek       - like pagecache_getpage, but only for a
+ *                           page that is already cached, resident, and
+ *                           not locked by anyone else; returns false
+ *                           instead of doing I/O or waiting for the
+ *                           page or for PF. Used for fault-around.
+ *    pagecache_sync       - write back pages of PF changed through
+ *                           shared mappings.
+ *    pagecache_syncall    - pagecache_sync every cached file.
+ *    pagecache_printstats - print hit/miss counts.
+ */
+
+#include <vm.h>
+
+struct vnode;
+struct region;
+struct lpage;
+struct pcfile;		/* Opaque. */
+
+void pagecache_bootstrap(void);
+struct pcfile *pagecache_attach(struct vnode *v);
+void pagecache_detach(struct pcfile *pf);
+int pagecache_getpage(struct pcfile *pf, struct region *reg, vaddr_t vaddr,
+		      struct lpage **lpret, paddr_t *paddrret);
+bool pagecache_peek(struct pcfile *pf, struct region *reg, vaddr_t vaddr,
+		    struct lpage **lpret, paddr_t *paddrret);
+int pagecache_sync(struct pcfile *pf);
+void pagecache_syncall(void);
+void pagecache_printstats(void);
+
+
+#endif /* _PAGECACHE_H_ */
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _PAGETABLE_H_
+#define _PAGETABLE_H_
+
+/*
+ * Page table: the per-address-space map from virtual page to the
+ * logical page (struct lpage) backing it.
+ *
+ * This is a two-level table. The top level is allocated with the
+ * address space; second-level tables are allocated when something
+ * is first mapped in the range they cover, so the size of the table
+ * is proportional to the parts of the address space actually used.
+ *
+ * Functions:
+ *
+ *    pt_create  - allocate an empty page table. Returns NULL on
+ *                 out-of-memory.
+ *    pt_destroy - destroy a page table, and lpage_decref every
+ *                 page still in it.
+ *    pt_copy    - fill DST (which must be empty) with all the pages
+ *                 in SRC, sharing them copy-on-write. On error, DST
+ *                 may be partially filled and should be destroyed.
+ *    pt_clear   - remove all pages in [START, END) from the table,
+ *                 and lpage_decref them.
+ *    pt_lookup  - return a pointer to the slot for VADDR, through
+ *                 which the lpage can be fetched or stored. If the
+ *                 second-level table for VADDR does not exist, it is
+ *                 allocated if CREATE is true (returning NULL if
+ *                 that fails) and otherwise NULL is returned.
+ */
+
+#include <vm.h>
+
+struct lpage;
+struct pagetable;
+
+struct pagetable *pt_create(void);
+void pt_destroy(struct pagetable *pt);
+int pt_copy(struct pagetable *src, struct pagetable *dst);
+void pt_clear(struct pagetable *pt, vaddr_t start, vaddr_t end);
+struct lpage **pt_lookup(struct pagetable *pt, vaddr_t vaddr, bool create);
+
+
+#endif /* _PAGETABLE_H_ */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _PID_H_
+#define _PID_H_
+
+/*
+ * Process IDs.
+ *
+ * The pid table is a fixed array of PID_NSLOTS slots. A pid lives in
+ * slot pid % PID_NSLOTS, so finding one is a single array index, and
+ * each slot has its own lock, so looking up one process never
+ * contends with work on another. Allocation pops a free slot off a
+ * stack, and is the only thing that takes a global lock. Each time a
+ * slot is freed its next pid advances by PID_NSLOTS, so pids are not
+ * reused until the slot has gone all the way round PID_MIN..PID_MAX.
+ *
+ * A slot also holds the exit status handoff: an exiting process
+ * posts its status in its slot and wakes the slot's wait channel,
+ * where its parent sleeps in waitpid. The parent frees the slot when
+ * it collects the status. A process whose parent has exited first
+ * (or that never had one, like those started from the menu) frees
+ * its own slot when it exits.
+ *
+ * Each process's children are on a list threaded through their
+ * slots. Only the parent changes it, and a process is single-
+ * threaded, so it needs no lock.
+ *
+ * Functions:
+ *
+ *    pid_bootstrap - set up the table. Call once during startup.
+ *    pid_alloc     - allocate a pid for a new child of PARENT, which
+ *                    is the caller's pid or INVALID_PID. Returns
+ *                    ENPROC if the table is full.
+ *    pid_unalloc   - give back a pid from pid_alloc whose process
+ *                    never ran, as when fork fails.
+ *    pid_exit      - PID exits with STATUS (as encoded by
+ *                    <kern/wait.h>). Also disowns its children.
+ *    pid_wait      - as waitpid: wait for PARENT's child PID to exit
+ *                    and collect its status. With WNOHANG, return at
+ *                    once with *RET set to 0 if it hasn't. The child
+ *                    stays waitable until pid_reap.
+ *    pid_reap      - free the pid of PARENT's child PID, which
+ *                    pid_wait has seen exit.
+ */
+
+#include <limits.h>
+
+/* Pid of kernel threads, and of no process */
+#define INVALID_PID	0
+
+/* Number of processes that can exist at once; a power of 2. */
+#define PID_NSLOTS	256
+
+void pid_bootstrap(void);
+int pid_alloc(pid_t parent, pid_t *ret);
+void pid_unalloc(pid_t pid);
+void pid_exit(pid_t pid, int status);
+int pid_wait(pid_t parent, pid_t pid, int *status, int flags, pid_t *ret);
+void pid_reap(pid_t parent, pid_t pid);
+
+
+#endif /* _PID_H_ */
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _POLL_H_
+#define _POLL_H_
+
+/*
+ * Waiting on many objects at once, for poll() and select().
+ *
+ * A wait channel can only have a thread asleep on one of them at a
+ * time, so a thread polling several files can't just sleep on each
+ * file's wchan. Instead the poller has a pollwait, which has its own
+ * wchan, and registers it on a pollqueue in each object it is
+ * interested in (the VOP_POLL of each file does this). When the
+ * object changes state it calls pollqueue_wake, which wakes every
+ * pollwait registered on it. The poller then checks all its files
+ * again; it sleeps once per round no matter how many files there
+ * are, and is only woken when one of them changes.
+ *
+ * Wakeups are never lost: a pollwait is marked as woken when woken,
+ * and pollwait_sleep returns at once if it has been woken since the
+ * last pollwait_reset. The poller resets, checks every file (having
+ * registered on it first), then sleeps.
+ *
+ * A pollwait can also have a timeout, in which case pollwait_sleep
+ * returns when it expires: a timeout (see timeout.h) wakes it just as
+ * a pollqueue would.
+ *
+ * Functions:
+ *
+ *    pollqueue_init    - initialize a pollqueue embedded in something.
+ *    pollqueue_cleanup - clean it up. No pollwaits may be registered.
+ *    pollqueue_wake    - wake every pollwait registered on PQ. May be
+ *                        called in an interrupt handler. Cheap if
+ *                        nobody is registered.
+ *
+ *    pollwait_init     - set up a pollwait that will be registered on
+ *                        at most MAXQUEUES pollqueues, with a timeout
+ *                        of TIMEOUT milliseconds, or none if TIMEOUT
+ *                        is negative. Returns ENOMEM if it can't.
+ *    pollwait_cleanup  - unregister from every pollqueue and clean up.
+ *    pollwait_register - register PW on PQ. PW may be NULL, in which
+ *                        case this does nothing; VOP_POLL passes the
+ *                        pollwait it was given straight through.
+ *    pollwait_reset    - forget about earlier wakeups.
+ *    pollwait_sleep    - sleep until woken or the timeout expires, or
+ *                        return at once if woken since the last reset.
+ *    pollwait_expired  - check if the timeout has expired.
+ */
+
+#include <kern/poll.h>
+#include <spinlock.h>
+#include <timeout.h>
+
+struct wchan;
+struct pollwait;
+
+/* Registration of one pollwait on one pollqueue */
+struct pollentry {
+	struct pollwait *pe_waiter;	/* the pollwait */
+	struct pollqueue *pe_queue;	/* the queue it is on */
+	struct pollentry *pe_prev;	/* links in pe_queue */
+	struct pollentry *pe_next;
+};
+
+struct pollqueue {
+	struct spinlock pq_lock;	/* protects pq_head */
+	struct pollentry *pq_head;	/* registered pollwaits */
+};
+
+struct pollwait {
+	struct spinlock pw_lock;	/* protects pw_woken */
+	struct wchan *pw_wchan;		/* poller sleeps here */
+	bool pw_woken;			/* woken since last reset */
+	struct pollentry *pw_entries;	/* registrations */
+	unsigned pw_nentries;		/* ...in use */
+	unsigned pw_maxentries;		/* ...allocated */
+	bool pw_timed;			/* has a timeout */
+	struct timeout pw_timeout;	/* ...which wakes it */
+};
+
+void pollqueue_init(struct pollqueue *pq);
+void pollqueue_cleanup(struct pollqueue *pq);
+void pollqueue_wake(struct pollqueue *pq);
+
+int pollwait_init(struct pollwait *pw, unsigned maxqueues, int timeout);
+void pollwait_cleanup(struct pollwait *pw);
+void pollwait_register(struct pollwait *pw, struct pollqueue *pq);
+void pollwait_reset(struct pollwait *pw);
+void pollwait_sleep(struct pollwait *pw);
+bool pollwait_expired(struct pollwait *pw);
+
+
+#endif /* _POLL_H_ */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _SWAP_H_
+#define _SWAP_H_
+
+/*
+ * Swap: backing store for evicted user pages.
+ *
+ * Swap space is a raw disk device (SWAP_DEVICE) divided into
+ * page-sized slots. If the device is not present, swapping is
+ * disabled and running out of physical memory is an error as
+ * before.
+ *
+ * Functions:
+ *
+ *    swap_bootstrap  - open the swap device. Called from vm_bootstrap.
+ *    swap_available  - true if there is a swap device.
+ *    swap_alloc      - reserve a slot. Returns ENOSPC if swap is
+ *                      full or there is no swap device.
+ *    swap_free       - release a slot.
+ *    swap_pagein     - read a slot into the physical page PADDR.
+ *    swap_pageout    - write the physical page PADDR to a slot.
+ *    swap_printstats - print slot usage and I/O counts.
+ */
+
+#include <vm.h>
+
+#define SWAP_DEVICE	"lhd1raw:"
+
+/* Slot number meaning "not in swap" */
+#define SWAP_NOSLOT	((unsigned)-1)
+
+void swap_bootstrap(void);
+bool swap_available(void);
+int swap_alloc(unsigned *slotret);
+void swap_free(unsigned slot);
+int swap_pagein(paddr_t paddr, unsigned slot);
+int swap_pageout(paddr_t paddr, unsigned slot);
+void swap_printstats(void);
+
+
+#endif /* _SWAP_H_ */
@@ -39,6 +39,8 @@
 #include <thread.h>
 #include <threadlist.h>
 
+struct timespec; /* from <kern/time.h> */
+
 /*
  * Dijkstra-style semaphore.
  *
@@ -91,6 +93,8 @@ void lock_acquire(struct lock *);
  * Operations:
  *    lock_acquire - Get the lock. Only one thread can hold the lock at the
  *                   same time.
+ *    lock_tryacquire - Get the lock if nobody holds it, without waiting.
+ *                   Returns true if it was acquired.
  *    lock_release - Free the lock. Only the thread holding the lock may do
  *                   this.
  *    lock_do_i_hold - Return true if the current thread holds the lock;
@@ -98,6 +102,7 @@ void lock_acquire(struct lock *);
  *
  * These operations must be atomic. You get to write them.
  */
+bool lock_tryacquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_do_i_hold(struct lock *);
 void lock_destroy(struct lock *);
@@ -134,7 +139,11 @@ void cv_destroy(struct cv *);
  *    cv_signal    - Wake up one thread that's sleeping on this CV.
  *    cv_broadcast - Wake up all threads sleeping on this CV.
  *
- * For all three operations, the current thread must hold the lock passed
+ *    cv_wait_timeout - Like cv_wait, but give up waiting at DEADLINE
+ *                   (as from getdeadline()). Returns 0 if signalled,
+ *                   or ETIMEDOUT; either way the lock is re-acquired.
+ *
+ * For all of these operations, the current thread must hold the lock passed
  * in. Note that under normal circumstances the same lock should be used
  * on all operations with any particular CV.
  *
@@ -143,6 +152,8 @@ void cv_destroy(struct cv *);
 void cv_wait(struct cv *cv, struct lock *lock);
 void cv_signal(struct cv *cv, struct lock *lock);
 void cv_broadcast(struct cv *cv, struct lock *lock);
+int cv_wait_timeout(struct cv *cv, struct lock *lock,
+		    const struct timespec *deadline);
 
 /*
  * 13 Feb 2012 : GWA : Reader-writer locks.
@@ -56,6 +56,32 @@ void enter_new_process(int argc, userptr_t argv, vaddr_t stackptr,
  */
 
 int sys_reboot(int code);
+int sys_fork(struct trapframe *tf, int32_t *retval);
+int sys_execv(userptr_t progname, userptr_t argv);
+int sys_waitpid(pid_t pid, userptr_t status, int options, int32_t *retval);
+int sys_getpid(int32_t *retval);
+void sys__exit(int code);
 int sys___time(userptr_t user_seconds, userptr_t user_nanoseconds);
+int sys_nanosleep(const_userptr_t req, userptr_t rem);
+int sys_open(userptr_t path, int flags, mode_t mode, int32_t *retval);
+int sys_pipe(userptr_t fds);
+int sys_read(int fd, userptr_t buf, size_t len, int32_t *retval);
+int sys_write(int fd, userptr_t buf, size_t len, int32_t *retval);
+int sys_pread(int fd, userptr_t buf, size_t len, off_t pos, int32_t *retval);
+int sys_pwrite(int fd, userptr_t buf, size_t len, off_t pos, int32_t *retval);
+int sys_readv(int fd, const_userptr_t iov, int iovcnt, int32_t *retval);
+int sys_writev(int fd, const_userptr_t iov, int iovcnt, int32_t *retval);
+int sys_close(int fd);
+int sys_lseek(int fd, off_t pos, int whence, off_t *retval);
+int sys_dup2(int oldfd, int newfd, int32_t *retval);
+int sys_poll(userptr_t fds, unsigned nfds, int timeout, int32_t *retval);
+int sys_select(int nfds, userptr_t readfds, userptr_t writefds,
+	       userptr_t exceptfds, userptr_t timeout, int32_t *retval);
+int sys_sbrk(intptr_t amount, int32_t *retval);
+int sys_mmap(userptr_t addr, size_t len, int prot, int flags, int fd,
+	     off_t offset, int32_t *retval);
+int sys_munmap(userptr_t addr, size_t len);
+int sys_mprotect(userptr_t addr, size_t len, int prot);
+int sys_madvise(userptr_t addr, size_t len, int advice);
 
 #endif /* _SYSCALL_H_ */
@@ -105,6 +105,9 @@ int malloctest(int, char **);
 int mallocstress(int, char **);
 int nettest(int, char **);
 
+/* virtual memory tests */
+int coremaptest(int, char **);
+
 /* Routine for running a user-level program. */
 int runprogram(char *progname);
 
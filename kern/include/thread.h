@@ -42,6 +42,7 @@
 struct addrspace;
 struct cpu;
 struct vnode;
+struct filetable;
 
 /* get machine-dependent defs */
 #include <machine/thread.h>
@@ -56,6 +57,9 @@ struct vnode;
 /* Macro to test if two addresses are on the same kernel stack */
 #define SAME_STACK(p1, p2)     (((p1) & STACK_MASK) == ((p2) & STACK_MASK))
 
+/* Names shorter than this are kept in the thread; longer ones are kmalloc'd */
+#define THREAD_NAMESIZE 32
+
 
 /* States a thread can be in. */
 typedef enum {
@@ -74,6 +78,7 @@ struct thread {
 	char *t_name;			/* Name of this thread */
 	const char *t_wchan_name;	/* Name of wait channel, if sleeping */
 	threadstate_t t_state;		/* State this thread is in */
+	char t_namebuf[THREAD_NAMESIZE]; /* Storage for short t_name */
 
 	/*
 	 * Thread subsystem internal fields.
@@ -84,6 +89,14 @@ struct thread {
 	struct switchframe *t_context;	/* Saved register context (on stack) */
 	struct cpu *t_cpu;		/* CPU thread runs on */
 
+	/*
+	 * Scheduler fields. Changed only by the thread itself, or
+	 * while it is on a run queue, under that run queue's lock.
+	 */
+	unsigned t_priority;		/* Run queue level; 0 is highest */
+	unsigned t_ticks;		/* Hardclocks used of this quantum */
+	unsigned t_queuedat;		/* t_cpu's hardclocks when queued */
+
 	/*
 	 * Interrupt state fields.
 	 *
@@ -110,6 +123,11 @@ struct thread {
 
 	/* VFS */
 	struct vnode *t_cwd;		/* current working directory */
+	struct filetable *t_filetable;	/* open files (user processes) */
+
+	/* Process */
+	pid_t t_pid;			/* pid, or INVALID_PID if none */
+	int t_exitstatus;		/* status for pid_exit */
 
 	/* add more here as needed */
 };
@@ -153,16 +171,24 @@ void thread_exit(void);
  */
 void thread_yield(void);
 
+/*
+ * Charge the current thread for a clock tick, and preempt it if it
+ * is time for something else to run. Called from the timer interrupt.
+ */
+void thread_tick(void);
+
 /*
  * Reshuffle the run queue. Called from the timer interrupt.
  */
 void schedule(void);
 
 /*
- * Potentially migrate ready threads to other CPUs. Called from the
- * timer interrupt.
+ * Decide how many ticks the current cpu can go before its next
+ * hardclock (up to IDLE_HARDCLOCKS when idle, ALONE_HARDCLOCKS when
+ * running one thread with nothing waiting), and set the timer
+ * accordingly. Called from the timer interrupt.
  */
-void thread_consider_migration(void);
+unsigned thread_nextclock(void);
 
 
 #endif /* _THREAD_H_ */
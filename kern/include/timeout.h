@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _TIMEOUT_H_
+#define _TIMEOUT_H_
+
+/*
+ * Timeouts: calling a function at a given time.
+ *
+ * Pending timeouts are kept on one list sorted by deadline, and the
+ * timer device that calls timerclock() is set to go off when the
+ * first of them is due (and at least once a second regardless), so
+ * a timeout fires within microseconds of its deadline rather than
+ * on the next one-second tick.
+ *
+ * The function is called from timerclock(), in an interrupt handler,
+ * with no locks held; it must not sleep. Timeouts are meant to be
+ * embedded in whatever they belong to: once timeout_remove returns
+ * the function is not running and will not run, so the timeout can
+ * then be thrown away.
+ *
+ * Functions:
+ *
+ *    timeout_init      - set up a timeout that calls FUNC(DATA).
+ *    timeout_add       - arrange for it to fire at time WHEN. It must
+ *                        not already be pending. If WHEN has passed
+ *                        it fires as soon as possible.
+ *    timeout_remove    - cancel it, waiting for the function to
+ *                        finish if it is running. Returns true if it
+ *                        was still pending, false if it had fired (or
+ *                        was never added).
+ *    timeout_expire    - fire every timeout that is due. Called from
+ *                        timerclock().
+ *    timeout_setdevice - called once at boot by the timer device
+ *                        driver, with a function that sets the device
+ *                        to interrupt once, USECS microseconds from
+ *                        now, and call timerclock().
+ */
+
+#include <kern/time.h>
+
+struct timeout {
+	struct timespec to_when;	/* deadline */
+	void (*to_func)(void *);	/* function to call */
+	void *to_data;			/* its argument */
+	bool to_pending;		/* on the list */
+	struct timeout *to_prev;	/* links on the list */
+	struct timeout *to_next;
+};
+
+void timeout_init(struct timeout *to, void (*func)(void *), void *data);
+void timeout_add(struct timeout *to, const struct timespec *when);
+bool timeout_remove(struct timeout *to);
+void timeout_expire(void);
+void timeout_setdevice(void (*settimer)(void *dev, uint32_t usecs),
+		       void *dev);
+
+
+#endif /* _TIMEOUT_H_ */
@@ -44,6 +44,34 @@
 #define VM_FAULT_WRITE       1    /* A write was attempted */
 #define VM_FAULT_READONLY    2    /* A write to a readonly page was attempted*/
 
+/*
+ * Default limit on the size of the user stack, in pages. Stacks start
+ * out one page long and grow down on demand up to the limit, which
+ * can be changed with the "stack" menu command.
+ */
+#define VM_STACKPAGES      256
+
+/*
+ * TLB prefill. The MIPS TLB only maps 4K pages, so instead of large
+ * pages, user memory is treated as aligned blocks of this many pages
+ * and a TLB miss refilled from the software TLB loads its cached
+ * translations for the rest of the block too. Sequential walks
+ * through big arrays and heaps then take one miss per block instead
+ * of one per page. Must be a power of 2.
+ */
+#define VM_PREFILLPAGES    4
+
+/*
+ * Fault-around. A page fault also maps the other resident pages
+ * around the faulting one, in an aligned window of this many pages
+ * by default. Each region has its own window size, which a program
+ * can change with madvise(); the default for new regions can be
+ * changed with the "faultaround" menu command, up to
+ * VM_FAULTAROUNDMAX. Must be a power of 2; 1 turns it off.
+ */
+#define VM_FAULTAROUND     16
+#define VM_FAULTAROUNDMAX  256
+
 
 /* Initialization function */
 void vm_bootstrap(void);
@@ -59,5 +87,71 @@ void free_kpages(vaddr_t addr);
 void vm_tlbshootdown_all(void);
 void vm_tlbshootdown(const struct tlbshootdown *);
 
+/*
+ * Background work for an idle cpu, called from the idle loop with
+ * interrupts off just before cpu_idle. Must not sleep.
+ */
+void vm_idle(void);
+
+/*
+ * Physical page allocation for user pages. LP is the lpage the page
+ * will belong to, which must be locked; the page may later be
+ * evicted from it. (If LP is NULL the page is never evicted.)
+ * page_alloc returns 0 if no memory is available. The page contents
+ * are not initialized. page_alloc may sleep to page something out.
+ * page_alloczero is the same but returns a zero-filled page, usually
+ * one zeroed ahead of time by vm_idle.
+ */
+struct lpage;
+paddr_t page_alloc(struct lpage *lp);
+paddr_t page_alloczero(struct lpage *lp);
+void page_free(paddr_t paddr);
+
+/*
+ * Machine-dependent MMU handling (arch/<machine>/vm/mmu.c).
+ *
+ *    mmu_map    - enter a translation from VADDR to PADDR for the
+ *                 current address space AS into this cpu's MMU,
+ *                 replacing any existing one for VADDR. If WRITEABLE
+ *                 is false, writes through the mapping will fault
+ *                 with VM_FAULT_READONLY.
+ *    mmu_invalidate - remove any translation for VADDR in AS,
+ *                 including cached ones, everywhere. AS must be the
+ *                 current address space or not running at all.
+ *    mmu_activate - make AS (which may be NULL) the current address
+ *                 space on this cpu. Translations for other address
+ *                 spaces are kept, but do not match.
+ *    mmu_refill - try to handle a TLB miss of type FAULTTYPE at
+ *                 VADDR in AS from cached translations, loading any
+ *                 cached ones for the rest of its VM_PREFILLPAGES
+ *                 block too. Returns true if it did, false if the
+ *                 fault needs the full vm_fault treatment.
+ *    mmu_revoke - forget all translations for AS, including cached
+ *                 ones, everywhere. AS must be the current address
+ *                 space or not running at all. Used when translations
+ *                 are removed or lose write permission.
+ *
+ *    mmu_bootstrap  - initialize. Called from vm_bootstrap.
+ *    mmu_asinit     - initialize the MMU state in a new address space.
+ *    mmu_shootdown  - remove all translations for the NPAGES physical
+ *                     pages in PADDRS from this cpu's MMU and those
+ *                     of the cpus in CPUMASK (bit N for cpu N), and
+ *                     wait until that is done. Each target cpu gets
+ *                     one IPI for the whole batch. May sleep.
+ *    mmu_printstats - print translation cache statistics.
+ */
+struct addrspace;
+void mmu_map(struct addrspace *as, vaddr_t vaddr, paddr_t paddr,
+	     bool writeable);
+void mmu_invalidate(struct addrspace *as, vaddr_t vaddr);
+void mmu_activate(struct addrspace *as);
+bool mmu_refill(struct addrspace *as, vaddr_t vaddr, int faulttype);
+void mmu_revoke(struct addrspace *as);
+void mmu_bootstrap(void);
+void mmu_asinit(struct addrspace *as);
+void mmu_shootdown(const paddr_t *paddrs, unsigned npages,
+		   uint32_t cpumask);
+void mmu_printstats(void);
+
 
 #endif /* _VM_H_ */
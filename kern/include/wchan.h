@@ -36,6 +36,7 @@
 
 
 struct wchan; /* Opaque */
+struct timespec; /* from <kern/time.h> */
 
 /*
  * Create a wait channel. Use NAME as a symbolic name for the channel.
@@ -71,6 +72,13 @@ void wchan_unlock(struct wchan *wc);
  */
 void wchan_sleep(struct wchan *wc);
 
+/*
+ * Like wchan_sleep, but also wake up at time DEADLINE (as from
+ * getdeadline()) if nobody has woken us by then. Returns 0 if woken,
+ * or ETIMEDOUT if the deadline passed first.
+ */
+int wchan_sleep_timeout(struct wchan *wc, const struct timespec *deadline);
+
 /*
  * Wake up one thread, or all threads, sleeping on a wait channel.
  * The queue should not already be locked.
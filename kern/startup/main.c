@@ -40,9 +40,11 @@
 #include <spl.h>
 #include <clock.h>
 #include <thread.h>
+#include <pid.h>
 #include <current.h>
 #include <synch.h>
 #include <vm.h>
+#include <pagecache.h>
 #include <mainbus.h>
 #include <vfs.h>
 #include <device.h>
@@ -50,6 +52,7 @@
 #include <test.h>
 #include <version.h>
 #include "autoconf.h"  // for pseudoconfig
+#include "opt-dumbvm.h"
 
 
 /*
@@ -109,6 +112,7 @@ boot(void)
 	ram_bootstrap();
 	thread_bootstrap();
 	hardclock_bootstrap();
+	pid_bootstrap();
 	vfs_bootstrap();
 
 	/* Probe and initialize devices. Interrupts should come on. */
@@ -146,6 +150,11 @@ shutdown(void)
 
 	kprintf("Shutting down.\n");
 
+#if !OPT_DUMBVM
+	/* Write back shared mappings of processes still running. */
+	pagecache_syncall();
+#endif
+
 	vfs_clearbootfs();
 	vfs_clearcurdir();
 	vfs_unmountall();
@@ -40,9 +40,14 @@
 #include <sfs.h>
 #include <syscall.h>
 #include <test.h>
+#include <addrspace.h>
+#include <coremap.h>
+#include <swap.h>
+#include <pagecache.h>
 #include "opt-synchprobs.h"
 #include "opt-sfs.h"
 #include "opt-net.h"
+#include "opt-dumbvm.h"
 
 /*
  * In-kernel menu and command dispatcher.
@@ -238,6 +243,9 @@ cmd_sync(int nargs, char **args)
 	(void)nargs;
 	(void)args;
 
+#if !OPT_DUMBVM
+	pagecache_syncall();
+#endif
 	vfs_sync();
 
 	return 0;
@@ -267,6 +275,9 @@ cmd_quit(int nargs, char **args)
 	(void)nargs;
 	(void)args;
 
+#if !OPT_DUMBVM
+	pagecache_syncall();
+#endif
 	vfs_sync();
 	sys_reboot(RB_POWEROFF);
 	thread_exit();
@@ -368,6 +379,71 @@ cmd_bootfs(int nargs, char **args)
 	return vfs_setbootfs(device);
 }
 
+#if !OPT_DUMBVM
+/*
+ * Command for selecting the page eviction policy.
+ */
+static
+int
+cmd_evict(int nargs, char **args)
+{
+	int result;
+
+	if (nargs != 2) {
+		kprintf("Usage: evict clock|random\n");
+		return EINVAL;
+	}
+
+	result = coremap_setpolicy(args[1]);
+	if (result) {
+		kprintf("Unknown eviction policy %s\n", args[1]);
+	}
+	return result;
+}
+
+/*
+ * Command for setting the stack size limit for new processes.
+ */
+static
+int
+cmd_stack(int nargs, char **args)
+{
+	int result;
+
+	if (nargs != 2) {
+		kprintf("Usage: stack pages\n");
+		return EINVAL;
+	}
+
+	result = as_setstacklimit(atoi(args[1]));
+	if (result) {
+		kprintf("Invalid stack size %s\n", args[1]);
+	}
+	return result;
+}
+
+/*
+ * Command for setting the fault-around window for new regions.
+ */
+static
+int
+cmd_faultaround(int nargs, char **args)
+{
+	int result;
+
+	if (nargs != 2) {
+		kprintf("Usage: faultaround pages\n");
+		return EINVAL;
+	}
+
+	result = as_setfaultaround(atoi(args[1]));
+	if (result) {
+		kprintf("Invalid fault-around window %s\n", args[1]);
+	}
+	return result;
+}
+#endif
+
 static
 int
 cmd_kheapstats(int nargs, char **args)
@@ -376,6 +452,13 @@ cmd_kheapstats(int nargs, char **args)
 	(void)args;
 
 	kheap_printstats();
+#if !OPT_DUMBVM
+	coremap_printstats();
+	swap_printstats();
+	pagecache_printstats();
+	mmu_printstats();
+	as_printstats();
+#endif
 
 	return 0;
 }
@@ -420,6 +503,11 @@ static const char *opsmenu[] = {
 	"[pwd]     Print current directory   ",
 	"[sync]    Sync filesystems          ",
 	"[panic]   Intentional panic         ",
+#if !OPT_DUMBVM
+	"[evict]   Set page eviction policy  ",
+	"[stack]   Set stack size limit      ",
+	"[faultaround] Set fault-around window",
+#endif
 	"[q]       Quit and shut down        ",
 	NULL
 };
@@ -457,6 +545,9 @@ static const char *testmenu[] = {
 	"[fs3] FS write stress       (4)     ",
 	"[fs4] FS write stress 2     (4)     ",
 	"[fs5] FS create stress      (4)     ",
+#if !OPT_DUMBVM
+	"[cm]  Coremap test                  ",
+#endif
 	NULL
 };
 
@@ -480,7 +571,7 @@ cmd_testmenu(int n, char **a)
 static const char *mainmenu[] = {
 	"[?o] Operations menu                ",
 	"[?t] Tests menu                     ",
-	"[kh] Kernel heap stats              ",
+	"[kh] Kernel heap and page stats     ",
 	"[q] Quit and shut down              ",
 	NULL
 };
@@ -522,6 +613,11 @@ static struct {
 	{ "pwd",	cmd_pwd },
 	{ "sync",	cmd_sync },
 	{ "panic",	cmd_panic },
+#if !OPT_DUMBVM
+	{ "evict",	cmd_evict },
+	{ "stack",	cmd_stack },
+	{ "faultaround", cmd_faultaround },
+#endif
 	{ "q",		cmd_quit },
 	{ "exit",	cmd_quit },
 	{ "halt",	cmd_quit },
@@ -563,6 +659,11 @@ static struct {
 	{ "fs4",	writestress2 },
 	{ "fs5",	createstress },
 
+#if !OPT_DUMBVM
+	/* virtual memory assignment tests */
+	{ "cm",		coremaptest },
+#endif
+
 	{ NULL, NULL }
 };
 
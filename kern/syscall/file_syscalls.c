@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <kern/seek.h>
+#include <kern/stat.h>
+#include <lib.h>
+#include <synch.h>
+#include <uio.h>
+#include <copyinout.h>
+#include <thread.h>
+#include <current.h>
+#include <vnode.h>
+#include <vfs.h>
+#include <file.h>
+#include <pipe.h>
+#include <syscall.h>
+
+/*
+ * File-related system calls.
+ */
+
+/* Position argument to file_rw meaning "use the seek position" */
+#define FILE_CURPOS	((off_t)-1)
+
+/* Number of iovecs readv and writev handle without kmalloc */
+#define FILE_NIOV	8
+
+/*
+ * Read or write through fd FD to or from the IOVCNT user buffers in
+ * IOV, all in one uio. If POS is FILE_CURPOS, the I/O happens at the
+ * seek position, which it advances. Otherwise it happens at POS and
+ * leaves the seek position alone and unlocked, so positional I/O
+ * never waits for other users of the same open file.
+ */
+static
+int
+file_rw(int fd, struct iovec *iov, unsigned iovcnt, off_t pos,
+	enum uio_rw rw, int32_t *retval)
+{
+	struct openfile *of;
+	struct uio u;
+	struct stat st;
+	size_t len;
+	unsigned i;
+	bool uselock;
+	int result;
+
+	result = filetable_get(curthread->t_filetable, fd, &of);
+	if (result) {
+		return result;
+	}
+	if (of->of_accmode == (rw == UIO_READ ? O_WRONLY : O_RDONLY)) {
+		return EBADF;
+	}
+
+	/* The byte count has to fit in the return value. */
+	len = 0;
+	for (i=0; i<iovcnt; i++) {
+		if (iov[i].iov_len > 0x7fffffff - len) {
+			return EINVAL;
+		}
+		len += iov[i].iov_len;
+	}
+
+	if (pos != FILE_CURPOS && !of->of_seekable) {
+		return ESPIPE;
+	}
+
+	u.uio_iov = iov;
+	u.uio_iovcnt = iovcnt;
+	u.uio_offset = 0;
+	u.uio_resid = len;
+	u.uio_segflg = UIO_USERSPACE;
+	u.uio_rw = rw;
+	u.uio_space = curthread->t_addrspace;
+
+	uselock = of->of_seekable && pos == FILE_CURPOS;
+	if (uselock) {
+		lock_acquire(of->of_lock);
+		if (rw == UIO_WRITE && of->of_append) {
+			result = VOP_STAT(of->of_vnode, &st);
+			if (result) {
+				lock_release(of->of_lock);
+				return result;
+			}
+			of->of_offset = st.st_size;
+		}
+		u.uio_offset = of->of_offset;
+	}
+	else if (pos != FILE_CURPOS) {
+		u.uio_offset = pos;
+	}
+
+	if (rw == UIO_READ) {
+		result = VOP_READ(of->of_vnode, &u);
+	}
+	else {
+		result = VOP_WRITE(of->of_vnode, &u);
+	}
+
+	if (uselock) {
+		of->of_offset = u.uio_offset;
+		lock_release(of->of_lock);
+	}
+	if (result) {
+		return result;
+	}
+
+	*retval = len - u.uio_resid;
+	return 0;
+}
+
+/*
+ * Read or write the user buffer BUF of LEN bytes through fd FD.
+ */
+static
+int
+file_rw1(int fd, userptr_t buf, size_t len, off_t pos, enum uio_rw rw,
+	 int32_t *retval)
+{
+	struct iovec iov;
+
+	iov.iov_ubase = buf;
+	iov.iov_len = len;
+	return file_rw(fd, &iov, 1, pos, rw, retval);
+}
+
+/*
+ * Read or write through fd FD using the IOVCNT iovecs at user
+ * address UIOV. The user's iovecs are used as the uio's directly;
+ * only the array itself is copied in.
+ */
+static
+int
+file_rwv(int fd, const_userptr_t uiov, int iovcnt, enum uio_rw rw,
+	 int32_t *retval)
+{
+	struct iovec smalliov[FILE_NIOV], *iov;
+	int result;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX) {
+		return EINVAL;
+	}
+
+	if (iovcnt <= FILE_NIOV) {
+		iov = smalliov;
+	}
+	else {
+		iov = kmalloc(iovcnt * sizeof(*iov));
+		if (iov == NULL) {
+			return ENOMEM;
+		}
+	}
+
+	result = copyin(uiov, iov, iovcnt * sizeof(*iov));
+	if (result == 0) {
+		result = file_rw(fd, iov, iovcnt, FILE_CURPOS, rw, retval);
+	}
+
+	if (iov != smalliov) {
+		kfree(iov);
+	}
+	return result;
+}
+
+/*
+ * open: open PATH and return a new file descriptor for it.
+ */
+int
+sys_open(userptr_t path, int flags, mode_t mode, int32_t *retval)
+{
+	struct filetable *ft;
+	struct openfile *of;
+	char *kpath;
+	int fd, result;
+
+	ft = curthread->t_filetable;
+	if (ft == NULL) {
+		return EMFILE;
+	}
+
+	kpath = kmalloc(PATH_MAX);
+	if (kpath == NULL) {
+		return ENOMEM;
+	}
+	result = copyinstr(path, kpath, PATH_MAX, NULL);
+	if (result) {
+		kfree(kpath);
+		return result;
+	}
+
+	result = openfile_open(kpath, flags, mode, &of);
+	kfree(kpath);
+	if (result) {
+		return result;
+	}
+
+	result = filetable_place(ft, of, &fd);
+	if (result) {
+		openfile_decref(of);
+		return result;
+	}
+
+	*retval = fd;
+	return 0;
+}
+
+/*
+ * pipe: make a pipe and return fds for its read and write ends in
+ * FDS.
+ */
+int
+sys_pipe(userptr_t fds)
+{
+	struct filetable *ft;
+	struct vnode *rv, *wv;
+	struct openfile *rof, *wof;
+	int kfds[2];
+	int result;
+
+	ft = curthread->t_filetable;
+	if (ft == NULL) {
+		return EMFILE;
+	}
+
+	result = pipe_create(&rv, &wv);
+	if (result) {
+		return result;
+	}
+	result = openfile_create(rv, O_RDONLY, &rof);
+	if (result) {
+		vfs_close(rv);
+		vfs_close(wv);
+		return result;
+	}
+	result = openfile_create(wv, O_WRONLY, &wof);
+	if (result) {
+		openfile_decref(rof);
+		vfs_close(wv);
+		return result;
+	}
+
+	result = filetable_place(ft, rof, &kfds[0]);
+	if (result) {
+		openfile_decref(rof);
+		openfile_decref(wof);
+		return result;
+	}
+	result = filetable_place(ft, wof, &kfds[1]);
+	if (result) {
+		filetable_set(ft, kfds[0], NULL);
+		openfile_decref(wof);
+		return result;
+	}
+
+	result = copyout(kfds, fds, sizeof(kfds));
+	if (result) {
+		filetable_set(ft, kfds[0], NULL);
+		filetable_set(ft, kfds[1], NULL);
+		return result;
+	}
+	return 0;
+}
+
+/*
+ * read: read up to LEN bytes from FD into BUF.
+ */
+int
+sys_read(int fd, userptr_t buf, size_t len, int32_t *retval)
+{
+	return file_rw1(fd, buf, len, FILE_CURPOS, UIO_READ, retval);
+}
+
+/*
+ * write: write up to LEN bytes from BUF to FD.
+ */
+int
+sys_write(int fd, userptr_t buf, size_t len, int32_t *retval)
+{
+	return file_rw1(fd, buf, len, FILE_CURPOS, UIO_WRITE, retval);
+}
+
+/*
+ * pread: read up to LEN bytes from FD at POS into BUF, without
+ * touching the seek position.
+ */
+int
+sys_pread(int fd, userptr_t buf, size_t len, off_t pos, int32_t *retval)
+{
+	if (pos < 0) {
+		return EINVAL;
+	}
+	return file_rw1(fd, buf, len, pos, UIO_READ, retval);
+}
+
+/*
+ * pwrite: write up to LEN bytes from BUF to FD at POS, without
+ * touching the seek position.
+ */
+int
+sys_pwrite(int fd, userptr_t buf, size_t len, off_t pos, int32_t *retval)
+{
+	if (pos < 0) {
+		return EINVAL;
+	}
+	return file_rw1(fd, buf, len, pos, UIO_WRITE, retval);
+}
+
+/*
+ * readv: read from FD into the IOVCNT buffers described by IOV.
+ */
+int
+sys_readv(int fd, const_userptr_t iov, int iovcnt, int32_t *retval)
+{
+	return file_rwv(fd, iov, iovcnt, UIO_READ, retval);
+}
+
+/*
+ * writev: write the IOVCNT buffers described by IOV to FD.
+ */
+int
+sys_writev(int fd, const_userptr_t iov, int iovcnt, int32_t *retval)
+{
+	return file_rwv(fd, iov, iovcnt, UIO_WRITE, retval);
+}
+
+/*
+ * close: release FD.
+ */
+int
+sys_close(int fd)
+{
+	struct openfile *of;
+	int result;
+
+	result = filetable_get(curthread->t_filetable, fd, &of);
+	if (result) {
+		return result;
+	}
+	filetable_set(curthread->t_filetable, fd, NULL);
+	return 0;
+}
+
+/*
+ * lseek: move the seek position of FD and return the new position.
+ */
+int
+sys_lseek(int fd, off_t pos, int whence, off_t *retval)
+{
+	struct openfile *of;
+	struct stat st;
+	off_t newpos;
+	int result;
+
+	result = filetable_get(curthread->t_filetable, fd, &of);
+	if (result) {
+		return result;
+	}
+	if (!of->of_seekable) {
+		return ESPIPE;
+	}
+
+	lock_acquire(of->of_lock);
+	switch (whence) {
+	    case SEEK_SET:
+		newpos = pos;
+		break;
+	    case SEEK_CUR:
+		newpos = of->of_offset + pos;
+		break;
+	    case SEEK_END:
+		result = VOP_STAT(of->of_vnode, &st);
+		if (result) {
+			lock_release(of->of_lock);
+			return result;
+		}
+		newpos = st.st_size + pos;
+		break;
+	    default:
+		lock_release(of->of_lock);
+		return EINVAL;
+	}
+
+	if (newpos < 0) {
+		lock_release(of->of_lock);
+		return EINVAL;
+	}
+	result = VOP_TRYSEEK(of->of_vnode, newpos);
+	if (result) {
+		lock_release(of->of_lock);
+		return result;
+	}
+	of->of_offset = newpos;
+	lock_release(of->of_lock);
+
+	*retval = newpos;
+	return 0;
+}
+
+/*
+ * dup2: make NEWFD refer to the same open file as OLDFD, closing
+ * NEWFD first if it was open.
+ */
+int
+sys_dup2(int oldfd, int newfd, int32_t *retval)
+{
+	struct openfile *of;
+	int result;
+
+	result = filetable_get(curthread->t_filetable, oldfd, &of);
+	if (result) {
+		return result;
+	}
+	if (newfd < 0 || newfd >= OPEN_MAX) {
+		return EBADF;
+	}
+
+	if (newfd != oldfd) {
+		openfile_incref(of);
+		filetable_set(curthread->t_filetable, newfd, of);
+	}
+
+	*retval = newfd;
+	return 0;
+}
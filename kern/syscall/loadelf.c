@@ -42,8 +42,9 @@
  * circumstances, as_prepare_load and as_complete_load probably don't
  * need to do anything.
  *
- * If you wanted to support memory-mapped executables you would need
- * to rearrange this to map each segment.
+ * Without dumbvm, executables are memory-mapped: each segment is
+ * defined with as_define_segment and read in from the file a page
+ * at a time as it faults in, so the second pass is skipped.
  *
  * To support dynamically linked executables with shared libraries
  * you'd need to change this to load the "ELF interpreter" (dynamic
@@ -52,6 +53,7 @@
 
 #include <types.h>
 #include <kern/errno.h>
+#include <kern/stat.h>
 #include <lib.h>
 #include <uio.h>
 #include <thread.h>
@@ -59,6 +61,7 @@
 #include <addrspace.h>
 #include <vnode.h>
 #include <elf.h>
+#include "opt-dumbvm.h"
 
 /*
  * Load a segment at virtual address VADDR. The segment in memory
@@ -72,8 +75,9 @@
  * Note that uiomove will catch it if someone tries to load an
  * executable whose load address is in kernel space. If you should
  * change this code to not use uiomove, be sure to check for this case
- * explicitly.
+ * explicitly. (as_define_segment does.)
  */
+#if OPT_DUMBVM
 static
 int
 load_segment(struct vnode *v, off_t offset, vaddr_t vaddr, 
@@ -143,6 +147,7 @@ load_segment(struct vnode *v, off_t offset, vaddr_t vaddr,
 	
 	return result;
 }
+#endif /* OPT_DUMBVM */
 
 /*
  * Load an ELF executable user program into the current address space.
@@ -157,6 +162,9 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 	int result, i;
 	struct iovec iov;
 	struct uio ku;
+#if !OPT_DUMBVM
+	struct stat st;
+#endif
 
 	/*
 	 * Read the executable header from offset 0 in the file.
@@ -198,6 +206,14 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 		return ENOEXEC;
 	}
 
+#if !OPT_DUMBVM
+	/* Segments are read in later; check they're all there now. */
+	result = VOP_STAT(v, &st);
+	if (result) {
+		return result;
+	}
+#endif
+
 	/*
 	 * Go through the list of segments and set up the address space.
 	 *
@@ -239,11 +255,35 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 			return ENOEXEC;
 		}
 
+#if OPT_DUMBVM
 		result = as_define_region(curthread->t_addrspace,
 					  ph.p_vaddr, ph.p_memsz,
 					  ph.p_flags & PF_R,
 					  ph.p_flags & PF_W,
 					  ph.p_flags & PF_X);
+#else
+		if (ph.p_filesz > ph.p_memsz) {
+			kprintf("ELF: warning: segment filesize > "
+				"segment memsize\n");
+			ph.p_filesz = ph.p_memsz;
+		}
+		if ((off_t)ph.p_offset + ph.p_filesz > st.st_size) {
+			kprintf("ELF: segment past end of file - "
+				"file truncated?\n");
+			return ENOEXEC;
+		}
+
+		DEBUG(DB_EXEC, "ELF: Mapping %lu bytes at 0x%lx\n",
+		      (unsigned long) ph.p_filesz,
+		      (unsigned long) ph.p_vaddr);
+
+		result = as_define_segment(curthread->t_addrspace,
+					   ph.p_vaddr, ph.p_memsz,
+					   v, ph.p_offset, ph.p_filesz,
+					   ph.p_flags & PF_R,
+					   ph.p_flags & PF_W,
+					   ph.p_flags & PF_X);
+#endif
 		if (result) {
 			return result;
 		}
@@ -254,6 +294,7 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 		return result;
 	}
 
+#if OPT_DUMBVM
 	/*
 	 * Now actually load each segment.
 	 */
@@ -291,6 +332,7 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 			return result;
 		}
 	}
+#endif /* OPT_DUMBVM */
 
 	result = as_complete_load(curthread->t_addrspace);
 	if (result) {
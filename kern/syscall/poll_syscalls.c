@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/time.h>
+#include <lib.h>
+#include <copyinout.h>
+#include <thread.h>
+#include <current.h>
+#include <vnode.h>
+#include <file.h>
+#include <poll.h>
+#include <syscall.h>
+
+/*
+ * poll() and select().
+ *
+ * Both work on an array of struct pollfd; select converts its
+ * descriptor sets to one and back. poll_wait checks every file, and
+ * if none is ready sleeps on a pollwait registered with all of them
+ * (see poll.h) until one changes or the timeout expires, then checks
+ * again. Each file is registered on the first pass only, and a file
+ * that changes between the check and the sleep has already woken the
+ * pollwait, so nothing is missed.
+ */
+
+/* Longest select timeout, in milliseconds (about 24 days) */
+#define POLL_MAXTIMEOUT	0x7fffffff
+
+/*
+ * Check each of the NFDS files in FDS, setting revents and counting
+ * those with anything to report in NREADY. Register PW with each
+ * one, unless it is NULL.
+ */
+static
+void
+poll_scan(struct pollfd *fds, unsigned nfds, struct pollwait *pw,
+	  unsigned *nready)
+{
+	struct openfile *of;
+	unsigned i;
+	int revents;
+	int result;
+
+	*nready = 0;
+	for (i=0; i<nfds; i++) {
+		if (fds[i].fd < 0) {
+			fds[i].revents = 0;
+			continue;
+		}
+		result = filetable_get(curthread->t_filetable, fds[i].fd, &of);
+		if (result) {
+			revents = POLLNVAL;
+		}
+		else {
+			result = VOP_POLL(of->of_vnode,
+					  fds[i].events & (POLLIN | POLLOUT),
+					  &revents, pw);
+			if (result) {
+				revents = POLLERR;
+			}
+		}
+		fds[i].revents = revents;
+		if (revents != 0) {
+			(*nready)++;
+		}
+	}
+}
+
+/*
+ * Wait for something to report on any of the NFDS files in FDS, or
+ * for TIMEOUT milliseconds to pass (forever if negative).
+ */
+static
+int
+poll_wait(struct pollfd *fds, unsigned nfds, int timeout, unsigned *nready)
+{
+	struct pollwait pw;
+	bool first;
+	int result;
+
+	if (timeout == 0) {
+		poll_scan(fds, nfds, NULL, nready);
+		return 0;
+	}
+
+	result = pollwait_init(&pw, nfds, timeout);
+	if (result) {
+		return result;
+	}
+
+	first = true;
+	while (1) {
+		pollwait_reset(&pw);
+		poll_scan(fds, nfds, first ? &pw : NULL, nready);
+		if (*nready > 0 || pollwait_expired(&pw)) {
+			break;
+		}
+		first = false;
+		pollwait_sleep(&pw);
+	}
+
+	pollwait_cleanup(&pw);
+	return 0;
+}
+
+int
+sys_poll(userptr_t ufds, unsigned nfds, int timeout, int32_t *retval)
+{
+	struct pollfd *fds;
+	unsigned nready;
+	int result;
+
+	if (nfds > OPEN_MAX) {
+		return EINVAL;
+	}
+
+	fds = NULL;
+	if (nfds > 0) {
+		fds = kmalloc(nfds * sizeof(*fds));
+		if (fds == NULL) {
+			return ENOMEM;
+		}
+		result = copyin(ufds, fds, nfds * sizeof(*fds));
+		if (result) {
+			kfree(fds);
+			return result;
+		}
+	}
+
+	result = poll_wait(fds, nfds, timeout, &nready);
+	if (result == 0 && nfds > 0) {
+		result = copyout(fds, ufds, nfds * sizeof(*fds));
+	}
+
+	if (fds != NULL) {
+		kfree(fds);
+	}
+	if (result) {
+		return result;
+	}
+	*retval = nready;
+	return 0;
+}
+
+/*
+ * Fetch a select descriptor set from userspace, or clear SET if
+ * USET is NULL.
+ */
+static
+int
+select_getset(userptr_t uset, fd_set *set)
+{
+	if (uset == NULL) {
+		FD_ZERO(set);
+		return 0;
+	}
+	return copyin(uset, set, sizeof(*set));
+}
+
+/*
+ * Wait for any file in the first NFDS of READFDS, WRITEFDS, and
+ * EXCEPTFDS to be ready as select() defines it, and replace the sets
+ * with the files found ready. End of file and errors count as
+ * readable (and errors as writeable), because read or write won't
+ * block. Nothing ever has exceptional conditions.
+ */
+static
+int
+select_wait(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+	    int timeout, unsigned *nready)
+{
+	struct pollfd *fds;
+	unsigned nfiles, i;
+	int fd;
+	int result;
+
+	/* Make a pollfd for each file in any of the sets. */
+	fds = NULL;
+	if (nfds > 0) {
+		fds = kmalloc(nfds * sizeof(*fds));
+		if (fds == NULL) {
+			return ENOMEM;
+		}
+	}
+	nfiles = 0;
+	for (fd=0; fd<nfds; fd++) {
+		if (!FD_ISSET(fd, readfds) && !FD_ISSET(fd, writefds) &&
+		    !FD_ISSET(fd, exceptfds)) {
+			continue;
+		}
+		fds[nfiles].fd = fd;
+		fds[nfiles].events = 0;
+		if (FD_ISSET(fd, readfds)) {
+			fds[nfiles].events |= POLLIN;
+		}
+		if (FD_ISSET(fd, writefds)) {
+			fds[nfiles].events |= POLLOUT;
+		}
+		nfiles++;
+	}
+
+	result = poll_wait(fds, nfiles, timeout, nready);
+	if (result) {
+		if (fds != NULL) {
+			kfree(fds);
+		}
+		return result;
+	}
+
+	FD_ZERO(readfds);
+	FD_ZERO(writefds);
+	FD_ZERO(exceptfds);
+	*nready = 0;
+	for (i=0; i<nfiles; i++) {
+		if (fds[i].revents & POLLNVAL) {
+			result = EBADF;
+			break;
+		}
+		fd = fds[i].fd;
+		if ((fds[i].events & POLLIN) &&
+		    (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+			FD_SET(fd, readfds);
+			(*nready)++;
+		}
+		if ((fds[i].events & POLLOUT) &&
+		    (fds[i].revents & (POLLOUT | POLLERR))) {
+			FD_SET(fd, writefds);
+			(*nready)++;
+		}
+	}
+
+	if (fds != NULL) {
+		kfree(fds);
+	}
+	return result;
+}
+
+/*
+ * Copy a select descriptor set back out to userspace, if USET isn't
+ * NULL.
+ */
+static
+int
+select_putset(const fd_set *set, userptr_t uset)
+{
+	if (uset == NULL) {
+		return 0;
+	}
+	return copyout(set, uset, sizeof(*set));
+}
+
+int
+sys_select(int nfds, userptr_t ureadfds, userptr_t uwritefds,
+	   userptr_t uexceptfds, userptr_t utimeout, int32_t *retval)
+{
+	fd_set readfds, writefds, exceptfds;
+	struct timeval tv;
+	unsigned nready;
+	int timeout;
+	int result;
+
+	if (nfds < 0 || nfds > FD_SETSIZE) {
+		return EINVAL;
+	}
+
+	timeout = -1;
+	if (utimeout != NULL) {
+		result = copyin(utimeout, &tv, sizeof(tv));
+		if (result) {
+			return result;
+		}
+		if (tv.tv_sec < 0 || tv.tv_usec < 0 || tv.tv_usec >= 1000000) {
+			return EINVAL;
+		}
+		if (tv.tv_sec >= POLL_MAXTIMEOUT / 1000) {
+			timeout = POLL_MAXTIMEOUT;
+		}
+		else {
+			/* Round up, so a short wait isn't no wait. */
+			timeout = tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+		}
+	}
+
+	result = select_getset(ureadfds, &readfds);
+	if (result) {
+		return result;
+	}
+	result = select_getset(uwritefds, &writefds);
+	if (result) {
+		return result;
+	}
+	result = select_getset(uexceptfds, &exceptfds);
+	if (result) {
+		return result;
+	}
+
+	result = select_wait(nfds, &readfds, &writefds, &exceptfds, timeout,
+			     &nready);
+	if (result) {
+		return result;
+	}
+
+	result = select_putset(&readfds, ureadfds);
+	if (result) {
+		return result;
+	}
+	result = select_putset(&writefds, uwritefds);
+	if (result) {
+		return result;
+	}
+	result = select_putset(&exceptfds, uexceptfds);
+	if (result) {
+		return result;
+	}
+
+	*retval = nready;
+	return 0;
+}
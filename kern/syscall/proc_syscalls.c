@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Process-related system calls.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <kern/wait.h>
+#include <lib.h>
+#include <limits.h>
+#include <copyinout.h>
+#include <mips/trapframe.h>
+#include <thread.h>
+#include <current.h>
+#include <addrspace.h>
+#include <vm.h>
+#include <vfs.h>
+#include <file.h>
+#include <pid.h>
+#include <syscall.h>
+
+/*
+ * What the parent in fork hands its child.
+ */
+struct forkargs {
+	struct trapframe fa_tf;		/* parent's trapframe */
+	struct addrspace *fa_as;	/* copy of the parent's memory */
+	struct filetable *fa_ft;	/* copy of the parent's files */
+	pid_t fa_pid;			/* the child's pid */
+};
+
+/*
+ * First function run by the child of fork: take over what the parent
+ * set up and go to user mode.
+ */
+static
+void
+fork_child(void *data1, unsigned long data2)
+{
+	struct forkargs *fa = data1;
+	struct trapframe tf;
+
+	(void)data2;
+
+	KASSERT(curthread->t_addrspace == NULL);
+	KASSERT(curthread->t_filetable == NULL);
+
+	curthread->t_addrspace = fa->fa_as;
+	curthread->t_filetable = fa->fa_ft;
+	curthread->t_pid = fa->fa_pid;
+	as_activate(curthread->t_addrspace);
+
+	/* The trapframe has to be on our own stack. */
+	tf = fa->fa_tf;
+	kfree(fa);
+
+	enter_forked_process(&tf);
+}
+
+int
+sys_fork(struct trapframe *tf, int32_t *retval)
+{
+	struct forkargs *fa;
+	int result;
+
+	fa = kmalloc(sizeof(*fa));
+	if (fa == NULL) {
+		return ENOMEM;
+	}
+	fa->fa_tf = *tf;
+
+	result = as_copy(curthread->t_addrspace, &fa->fa_as);
+	if (result) {
+		kfree(fa);
+		return result;
+	}
+	result = filetable_copy(curthread->t_filetable, &fa->fa_ft);
+	if (result) {
+		as_destroy(fa->fa_as);
+		kfree(fa);
+		return result;
+	}
+	result = pid_alloc(curthread->t_pid, &fa->fa_pid);
+	if (result) {
+		filetable_destroy(fa->fa_ft);
+		as_destroy(fa->fa_as);
+		kfree(fa);
+		return result;
+	}
+
+	/* Once the child is running it owns FA; don't touch it. */
+	*retval = fa->fa_pid;
+
+	result = thread_fork(curthread->t_name, fork_child, fa, 0, NULL);
+	if (result) {
+		pid_unalloc(fa->fa_pid);
+		filetable_destroy(fa->fa_ft);
+		as_destroy(fa->fa_as);
+		kfree(fa);
+		return result;
+	}
+
+	return 0;
+}
+
+/*
+ * Copy in the argument strings of execv, packing them one after
+ * another into BUF, which is ARG_MAX bytes long. Hands back the
+ * number of arguments and the number of bytes used.
+ */
+static
+int
+execv_copyinargs(userptr_t uargv, char *buf, int *argc, size_t *len)
+{
+	userptr_t uarg;
+	size_t reserve, got;
+	int result;
+
+	*argc = 0;
+	*len = 0;
+	while (1) {
+		result = copyin(uargv, &uarg, sizeof(uarg));
+		if (result) {
+			return result;
+		}
+		if (uarg == NULL) {
+			break;
+		}
+
+		/*
+		 * Leave room for the argv array, including this
+		 * argument and the terminating NULL, and for padding
+		 * to align it.
+		 */
+		reserve = (*argc + 3) * sizeof(userptr_t);
+		if (*len + reserve >= ARG_MAX) {
+			return E2BIG;
+		}
+		result = copyinstr(uarg, buf + *len, ARG_MAX - *len - reserve,
+				   &got);
+		if (result == ENAMETOOLONG) {
+			return E2BIG;
+		}
+		if (result) {
+			return result;
+		}
+		*len += got;
+		(*argc)++;
+		uargv += sizeof(userptr_t);
+	}
+	return 0;
+}
+
+/*
+ * Copy the ARGC argument strings packed into the LEN bytes of BUF
+ * onto the top of the new user stack at *STACKPTR, followed (below)
+ * by the argv array pointing at them. Updates *STACKPTR and hands
+ * back the user address of argv. The argv array is built in place in
+ * BUF after the strings, so each part goes out in one copyout.
+ */
+static
+int
+execv_copyoutargs(char *buf, int argc, size_t len, vaddr_t *stackptr,
+		  userptr_t *uargv)
+{
+	userptr_t *argv;
+	vaddr_t strings, stack;
+	size_t pos, arraylen;
+	int i;
+	int result;
+
+	stack = *stackptr;
+	strings = stack - ROUNDUP(len, 8);
+	arraylen = (argc + 1) * sizeof(userptr_t);
+
+	argv = (userptr_t *)(buf + ROUNDUP(len, sizeof(userptr_t)));
+	KASSERT(ROUNDUP(len, sizeof(userptr_t)) + arraylen <= ARG_MAX);
+	pos = 0;
+	for (i=0; i<argc; i++) {
+		argv[i] = (userptr_t)(strings + pos);
+		pos += strlen(buf + pos) + 1;
+	}
+	argv[argc] = NULL;
+
+	result = copyout(buf, (userptr_t)strings, len);
+	if (result) {
+		return result;
+	}
+	stack = strings - ROUNDUP(arraylen, 8);
+	result = copyout(argv, (userptr_t)stack, arraylen);
+	if (result) {
+		return result;
+	}
+
+	*stackptr = stack;
+	*uargv = (userptr_t)stack;
+	return 0;
+}
+
+int
+sys_execv(userptr_t uprogname, userptr_t uargv)
+{
+	struct addrspace *oldas, *newas;
+	struct vnode *v;
+	char *progname, *args;
+	vaddr_t entrypoint, stackptr;
+	userptr_t argv;
+	size_t len;
+	int argc;
+	int result;
+
+	progname = kmalloc(PATH_MAX);
+	if (progname == NULL) {
+		return ENOMEM;
+	}
+	args = kmalloc(ARG_MAX);
+	if (args == NULL) {
+		kfree(progname);
+		return ENOMEM;
+	}
+
+	result = copyinstr(uprogname, progname, PATH_MAX, NULL);
+	if (result == 0) {
+		result = execv_copyinargs(uargv, args, &argc, &len);
+	}
+	if (result == 0) {
+		/* vfs_open may destroy progname; we're done with it after. */
+		result = vfs_open(progname, O_RDONLY, 0, &v);
+	}
+	kfree(progname);
+	if (result) {
+		kfree(args);
+		return result;
+	}
+
+	newas = as_create();
+	if (newas == NULL) {
+		vfs_close(v);
+		kfree(args);
+		return ENOMEM;
+	}
+
+	/* Switch to the new address space and load into it. */
+	oldas = curthread->t_addrspace;
+	curthread->t_addrspace = newas;
+	as_activate(newas);
+
+	result = load_elf(v, &entrypoint);
+	vfs_close(v);
+	if (result == 0) {
+		result = as_define_stack(newas, &stackptr);
+	}
+	if (result == 0) {
+		result = execv_copyoutargs(args, argc, len, &stackptr, &argv);
+	}
+	kfree(args);
+	if (result) {
+		/* Go back to the old image, which is still intact. */
+		curthread->t_addrspace = oldas;
+		as_activate(oldas);
+		as_destroy(newas);
+		return result;
+	}
+
+	/* No going back now. */
+	as_destroy(oldas);
+
+	enter_new_process(argc, argv, stackptr, entrypoint);
+
+	/* enter_new_process does not return. */
+	panic("enter_new_process returned\n");
+	return EINVAL;
+}
+
+int
+sys_waitpid(pid_t pid, userptr_t ustatus, int options, int32_t *retval)
+{
+	pid_t ret;
+	int status;
+	int result;
+
+	if ((vaddr_t)ustatus % sizeof(status) != 0) {
+		return EFAULT;
+	}
+
+	result = pid_wait(curthread->t_pid, pid, &status, options, &ret);
+	if (result) {
+		return result;
+	}
+	if (ret == 0) {
+		/* WNOHANG, and it hasn't exited */
+		*retval = 0;
+		return 0;
+	}
+
+	/* If the status can't be delivered, leave the child waitable. */
+	if (ustatus != NULL) {
+		result = copyout(&status, ustatus, sizeof(status));
+		if (result) {
+			return result;
+		}
+	}
+	pid_reap(curthread->t_pid, ret);
+	*retval = ret;
+	return 0;
+}
+
+int
+sys_getpid(int32_t *retval)
+{
+	*retval = curthread->t_pid;
+	return 0;
+}
+
+void
+sys__exit(int code)
+{
+	curthread->t_exitstatus = _MKWAIT_EXIT(code);
+	thread_exit();
+}
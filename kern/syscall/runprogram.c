@@ -42,6 +42,8 @@
 #include <addrspace.h>
 #include <vm.h>
 #include <vfs.h>
+#include <file.h>
+#include <pid.h>
 #include <syscall.h>
 #include <test.h>
 
@@ -66,6 +68,28 @@ runprogram(char *progname)
 
 	/* We should be a new thread. */
 	KASSERT(curthread->t_addrspace == NULL);
+	KASSERT(curthread->t_filetable == NULL);
+	KASSERT(curthread->t_pid == INVALID_PID);
+
+	/* Become a process, with no parent. */
+	result = pid_alloc(INVALID_PID, &curthread->t_pid);
+	if (result) {
+		vfs_close(v);
+		return result;
+	}
+
+	/* Give it a file table with stdin, stdout, and stderr. */
+	curthread->t_filetable = filetable_create();
+	if (curthread->t_filetable == NULL) {
+		vfs_close(v);
+		return ENOMEM;
+	}
+	result = filetable_openconsole(curthread->t_filetable);
+	if (result) {
+		/* thread_exit destroys curthread->t_filetable */
+		vfs_close(v);
+		return result;
+	}
 
 	/* Create a new address space. */
 	curthread->t_addrspace = as_create();
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <kern/mman.h>
+#include <lib.h>
+#include <thread.h>
+#include <current.h>
+#include <addrspace.h>
+#include <file.h>
+#include <syscall.h>
+
+/*
+ * Memory management system calls.
+ */
+
+/*
+ * sbrk: move the end of the heap by AMOUNT bytes and return the old
+ * end.
+ */
+int
+sys_sbrk(intptr_t amount, int32_t *retval)
+{
+	struct addrspace *as;
+	vaddr_t oldend;
+	int result;
+
+	as = curthread->t_addrspace;
+	if (as == NULL) {
+		return EINVAL;
+	}
+
+	result = as_sbrk(as, amount, &oldend);
+	if (result) {
+		return result;
+	}
+
+	*retval = (int32_t)oldend;
+	return 0;
+}
+
+/*
+ * mmap: map a file, or zero-filled memory with MAP_ANON, and return
+ * the address chosen.
+ */
+int
+sys_mmap(userptr_t addr, size_t len, int prot, int flags, int fd,
+	 off_t offset, int32_t *retval)
+{
+	struct addrspace *as;
+	struct openfile *of;
+	struct vnode *v;
+	bool canwrite;
+	vaddr_t result_addr;
+	int result;
+
+	as = curthread->t_addrspace;
+	if (as == NULL) {
+		return EINVAL;
+	}
+
+	if (flags & MAP_ANON) {
+		v = NULL;
+		offset = 0;
+		canwrite = true;
+	}
+	else {
+		result = filetable_get(curthread->t_filetable, fd, &of);
+		if (result) {
+			return result;
+		}
+		/*
+		 * The file must be open for reading, and for writing
+		 * too if changes through the mapping reach the file.
+		 */
+		if (of->of_accmode == O_WRONLY) {
+			return EACCES;
+		}
+		if ((flags & MAP_SHARED) && (prot & PROT_WRITE) &&
+		    of->of_accmode != O_RDWR) {
+			return EACCES;
+		}
+		v = of->of_vnode;
+		canwrite = of->of_accmode == O_RDWR;
+	}
+
+	result = as_mmap(as, (vaddr_t)addr, len, prot, flags, v, offset,
+			 canwrite, &result_addr);
+	if (result) {
+		return result;
+	}
+
+	*retval = (int32_t)result_addr;
+	return 0;
+}
+
+/*
+ * munmap: remove mappings made by mmap.
+ */
+int
+sys_munmap(userptr_t addr, size_t len)
+{
+	struct addrspace *as;
+
+	as = curthread->t_addrspace;
+	if (as == NULL) {
+		return EINVAL;
+	}
+	return as_munmap(as, (vaddr_t)addr, len);
+}
+
+/*
+ * mprotect: change the permissions of mappings made by mmap.
+ */
+int
+sys_mprotect(userptr_t addr, size_t len, int prot)
+{
+	struct addrspace *as;
+
+	as = curthread->t_addrspace;
+	if (as == NULL) {
+		return EINVAL;
+	}
+	return as_mprotect(as, (vaddr_t)addr, len, prot);
+}
+
+/*
+ * madvise: set the fault-around window of part of the address space.
+ */
+int
+sys_madvise(userptr_t addr, size_t len, int advice)
+{
+	struct addrspace *as;
+
+	as = curthread->t_addrspace;
+	if (as == NULL) {
+		return EINVAL;
+	}
+	return as_madvise(as, (vaddr_t)addr, len, advice);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Coremap test code.
+ *
+ * Exercises alloc_kpages/free_kpages and page_alloc/page_free,
+ * including multi-page runs, and checks that pages handed out, freed,
+ * and handed out again never overlap.
+ */
+#include <types.h>
+#include <lib.h>
+#include <vm.h>
+#include <test.h>
+
+#define TESTPAGES	32
+#define RUNPAGES	4
+
+/*
+ * Fill a kernel page with a pattern derived from its address, so
+ * overlapping allocations are caught when checked.
+ */
+static
+void
+fillpage(vaddr_t va)
+{
+	uint32_t *p = (uint32_t *)va;
+	unsigned i;
+
+	for (i=0; i<PAGE_SIZE/sizeof(uint32_t); i++) {
+		p[i] = va ^ i;
+	}
+}
+
+static
+void
+checkpage(vaddr_t va)
+{
+	uint32_t *p = (uint32_t *)va;
+	unsigned i;
+
+	for (i=0; i<PAGE_SIZE/sizeof(uint32_t); i++) {
+		KASSERT(p[i] == (va ^ i));
+	}
+}
+
+int
+coremaptest(int nargs, char **args)
+{
+	vaddr_t pages[TESTPAGES];
+	paddr_t upage;
+	vaddr_t run;
+	unsigned i, j;
+
+	(void)nargs;
+	(void)args;
+
+	kprintf("Starting coremap test...\n");
+
+	/* single pages */
+	for (i=0; i<TESTPAGES; i++) {
+		pages[i] = alloc_kpages(1);
+		KASSERT(pages[i] != 0);
+		KASSERT((pages[i] & PAGE_FRAME) == pages[i]);
+		for (j=0; j<i; j++) {
+			KASSERT(pages[j] != pages[i]);
+		}
+		fillpage(pages[i]);
+	}
+	for (i=0; i<TESTPAGES; i++) {
+		checkpage(pages[i]);
+	}
+
+	/*
+	 * Free a kernel page and take a user page. It's probably the
+	 * same page, but other cpus may be allocating (or prezeroing)
+	 * too, so just check it doesn't overlap anything still live.
+	 */
+	free_kpages(pages[0]);
+	upage = page_alloc(NULL);
+	KASSERT(upage != 0);
+	for (i=1; i<TESTPAGES; i++) {
+		KASSERT(PADDR_TO_KVADDR(upage) != pages[i]);
+	}
+	fillpage(PADDR_TO_KVADDR(upage));
+	for (i=1; i<TESTPAGES; i++) {
+		checkpage(pages[i]);
+	}
+	checkpage(PADDR_TO_KVADDR(upage));
+	page_free(upage);
+	pages[0] = alloc_kpages(1);
+	KASSERT(pages[0] != 0);
+	fillpage(pages[0]);
+
+	/* contiguous runs */
+	run = alloc_kpages(RUNPAGES);
+	KASSERT(run != 0);
+	for (i=0; i<RUNPAGES; i++) {
+		fillpage(run + i*PAGE_SIZE);
+	}
+	for (i=0; i<TESTPAGES; i++) {
+		checkpage(pages[i]);
+		KASSERT(pages[i] < run || pages[i] >= run + RUNPAGES*PAGE_SIZE);
+	}
+	for (i=0; i<RUNPAGES; i++) {
+		checkpage(run + i*PAGE_SIZE);
+	}
+	free_kpages(run);
+
+	for (i=0; i<TESTPAGES; i++) {
+		checkpage(pages[i]);
+		free_kpages(pages[i]);
+	}
+
+	kprintf("Coremap test complete\n");
+	return 0;
+}
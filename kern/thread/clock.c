@@ -28,19 +28,20 @@
  */
 
 #include <types.h>
+#include <kern/errno.h>
 #include <lib.h>
 #include <cpu.h>
 #include <wchan.h>
 #include <clock.h>
 #include <thread.h>
 #include <current.h>
+#include <timeout.h>
 
 /*
  * Time handling.
  *
- * This is pretty primitive. A real kernel will typically have some
- * kind of support for scheduling callbacks to happen at specific
- * points in the future, usually with more resolution that one second.
+ * Callbacks at specific points in the future are handled by the
+ * timeout code (see timeout.c), which runs off timerclock().
  *
  * A real kernel also has to maintain the time of day; in OS/161 we
  * skimp on that because we have a known-good hardware clock.
@@ -51,12 +52,12 @@
  * the scheduler.
  */
 #define SCHEDULE_HARDCLOCKS	4	/* Reschedule every 4 hardclocks. */
-#define MIGRATE_HARDCLOCKS	16	/* Migrate every 16 hardclocks. */
 
 /*
- * Once a second, everything waiting on lbolt is awakened by CPU 0.
+ * Threads in clocksleep and clocksleep_until sleep here. Nobody wakes it; they
+ * wait for their timeouts.
  */
-static struct wchan *lbolt;
+static struct wchan *napchan;
 
 /*
  * Setup.
@@ -64,21 +65,21 @@ static struct wchan *lbolt;
 void
 hardclock_bootstrap(void)
 {
-	lbolt = wchan_create("lbolt");
-	if (lbolt == NULL) {
-		panic("Couldn't create lbolt\n");
+	napchan = wchan_create("nanosleep");
+	if (napchan == NULL) {
+		panic("Couldn't create napchan\n");
 	}
 }
 
 /*
- * This is called once per second, on one processor, by the timer
- * code.
+ * This is called at least once per second, and whenever a timeout is
+ * due, on one processor, by the timer code.
  */
 void
 timerclock(void)
 {
-	/* Just broadcast on lbolt */
-	wchan_wakeall(lbolt);
+	/* Fire timeouts that are due */
+	timeout_expire();
 }
 
 /*
@@ -88,18 +89,66 @@ timerclock(void)
 void
 hardclock(void)
 {
+	unsigned before;
+
 	/*
 	 * Collect statistics here as desired.
 	 */
 
-	curcpu->c_hardclocks++;
-	if ((curcpu->c_hardclocks % SCHEDULE_HARDCLOCKS) == 0) {
+	/*
+	 * The timer may have been set for more than one tick; count
+	 * them all, and reschedule if that crossed a boundary.
+	 */
+	before = curcpu->c_hardclocks;
+	curcpu->c_hardclocks += curcpu->c_timerticks;
+	if (curcpu->c_hardclocks / SCHEDULE_HARDCLOCKS !=
+	    before / SCHEDULE_HARDCLOCKS) {
 		schedule();
 	}
-	if ((curcpu->c_hardclocks % MIGRATE_HARDCLOCKS) == 0) {
-		thread_consider_migration();
+
+	/*
+	 * Set up the next tick before thread_tick, which may switch
+	 * to another thread and not come back for a while.
+	 */
+	thread_nextclock();
+	thread_tick();
+}
+
+/*
+ * Compute a deadline SECS and NSECS from now.
+ */
+void
+getdeadline(time_t secs, uint32_t nsecs, struct timespec *deadline)
+{
+	time_t nowsecs;
+	uint32_t nownsecs;
+
+	KASSERT(nsecs < 1000000000);
+
+	gettime(&nowsecs, &nownsecs);
+	nowsecs += secs;
+	nownsecs += nsecs;
+	if (nownsecs >= 1000000000) {
+		nownsecs -= 1000000000;
+		nowsecs++;
+	}
+	deadline->tv_sec = nowsecs;
+	deadline->tv_nsec = nownsecs;
+}
+
+/*
+ * Compare two times: negative if A is earlier, positive if later.
+ */
+int
+timespec_cmp(const struct timespec *a, const struct timespec *b)
+{
+	if (a->tv_sec != b->tv_sec) {
+		return a->tv_sec < b->tv_sec ? -1 : 1;
+	}
+	if (a->tv_nsec != b->tv_nsec) {
+		return a->tv_nsec < b->tv_nsec ? -1 : 1;
 	}
-	thread_yield();
+	return 0;
 }
 
 /*
@@ -108,9 +157,25 @@ hardclock(void)
 void
 clocksleep(int num_secs)
 {
-	while (num_secs > 0) {
-		wchan_lock(lbolt);
-		wchan_sleep(lbolt);
-		num_secs--;
+	struct timespec deadline;
+
+	if (num_secs <= 0) {
+		return;
 	}
+	getdeadline(num_secs, 0, &deadline);
+	clocksleep_until(&deadline);
+}
+
+/*
+ * Suspend execution until DEADLINE.
+ */
+void
+clocksleep_until(const struct timespec *deadline)
+{
+	int result;
+
+	do {
+		wchan_lock(napchan);
+		result = wchan_sleep_timeout(napchan, deadline);
+	} while (result != ETIMEDOUT);
 }
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Process ID table. See pid.h.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/wait.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <pid.h>
+
+/* No slot, for the child lists */
+#define PID_NOSLOT	(-1)
+
+#define PID_SLOT(pid)	((pid) & (PID_NSLOTS - 1))
+
+struct pidslot {
+	struct spinlock ps_lock;	/* protects the next four */
+	pid_t ps_pid;			/* the pid, or INVALID_PID if free */
+	pid_t ps_parent;		/* parent, or INVALID_PID */
+	bool ps_exited;			/* has exited */
+	int ps_status;			/* exit status, once exited */
+
+	struct wchan *ps_wchan;		/* parent waits here for exit */
+	pid_t ps_nextpid;		/* pid for the next use of the slot */
+
+	/* Child lists; belong to the parent (see pid.h) */
+	int ps_firstchild;		/* this process's first child */
+	int ps_prevsib;			/* links in parent's list */
+	int ps_nextsib;
+};
+
+static struct pidslot pid_slots[PID_NSLOTS];
+
+/* Stack of free slots */
+static struct spinlock pid_freelock = SPINLOCK_INITIALIZER;
+static int pid_freeslots[PID_NSLOTS];
+static unsigned pid_nfree;
+
+/*
+ * The first pid a slot hands out. Pids below PID_MIN are reserved.
+ */
+static
+pid_t
+pid_firstpid(int slot)
+{
+	return slot < PID_MIN ? slot + PID_NSLOTS : slot;
+}
+
+void
+pid_bootstrap(void)
+{
+	struct pidslot *ps;
+	int i;
+
+	KASSERT(PID_NSLOTS <= PID_MAX + 1 - PID_MIN);
+
+	pid_nfree = 0;
+	for (i=PID_NSLOTS-1; i>=0; i--) {
+		ps = &pid_slots[i];
+		spinlock_init(&ps->ps_lock);
+		ps->ps_pid = INVALID_PID;
+		ps->ps_parent = INVALID_PID;
+		ps->ps_exited = false;
+		ps->ps_status = 0;
+		ps->ps_wchan = wchan_create("wait");
+		if (ps->ps_wchan == NULL) {
+			panic("pid_bootstrap: Out of memory\n");
+		}
+		ps->ps_nextpid = pid_firstpid(i);
+		ps->ps_firstchild = PID_NOSLOT;
+		ps->ps_prevsib = ps->ps_nextsib = PID_NOSLOT;
+
+		pid_freeslots[pid_nfree++] = i;
+	}
+}
+
+/*
+ * Put a slot back on the free stack, advancing its next pid.
+ */
+static
+void
+pid_freeslot(int slot)
+{
+	struct pidslot *ps = &pid_slots[slot];
+
+	spinlock_acquire(&ps->ps_lock);
+	ps->ps_pid = INVALID_PID;
+	ps->ps_parent = INVALID_PID;
+	ps->ps_exited = false;
+	ps->ps_nextpid += PID_NSLOTS;
+	if (ps->ps_nextpid > PID_MAX) {
+		ps->ps_nextpid = pid_firstpid(slot);
+	}
+	spinlock_release(&ps->ps_lock);
+
+	spinlock_acquire(&pid_freelock);
+	KASSERT(pid_nfree < PID_NSLOTS);
+	pid_freeslots[pid_nfree++] = slot;
+	spinlock_release(&pid_freelock);
+}
+
+/*
+ * Take the child in SLOT off its parent's list of children.
+ */
+static
+void
+pid_unlink(pid_t parent, int slot)
+{
+	struct pidslot *ps = &pid_slots[slot];
+
+	if (ps->ps_prevsib != PID_NOSLOT) {
+		pid_slots[ps->ps_prevsib].ps_nextsib = ps->ps_nextsib;
+	}
+	else {
+		KASSERT(pid_slots[PID_SLOT(parent)].ps_firstchild == slot);
+		pid_slots[PID_SLOT(parent)].ps_firstchild = ps->ps_nextsib;
+	}
+	if (ps->ps_nextsib != PID_NOSLOT) {
+		pid_slots[ps->ps_nextsib].ps_prevsib = ps->ps_prevsib;
+	}
+	ps->ps_prevsib = ps->ps_nextsib = PID_NOSLOT;
+}
+
+int
+pid_alloc(pid_t parent, pid_t *ret)
+{
+	struct pidslot *ps, *pps;
+	int slot;
+
+	spinlock_acquire(&pid_freelock);
+	if (pid_nfree == 0) {
+		spinlock_release(&pid_freelock);
+		return ENPROC;
+	}
+	slot = pid_freeslots[--pid_nfree];
+	spinlock_release(&pid_freelock);
+
+	ps = &pid_slots[slot];
+	spinlock_acquire(&ps->ps_lock);
+	KASSERT(ps->ps_pid == INVALID_PID);
+	ps->ps_pid = ps->ps_nextpid;
+	ps->ps_parent = parent;
+	ps->ps_exited = false;
+	ps->ps_status = 0;
+	spinlock_release(&ps->ps_lock);
+	ps->ps_firstchild = PID_NOSLOT;
+
+	/* Add to the parent's list of children. */
+	ps->ps_prevsib = PID_NOSLOT;
+	ps->ps_nextsib = PID_NOSLOT;
+	if (parent != INVALID_PID) {
+		pps = &pid_slots[PID_SLOT(parent)];
+		KASSERT(pps->ps_pid == parent);
+		ps->ps_nextsib = pps->ps_firstchild;
+		if (pps->ps_firstchild != PID_NOSLOT) {
+			pid_slots[pps->ps_firstchild].ps_prevsib = slot;
+		}
+		pps->ps_firstchild = slot;
+	}
+
+	*ret = ps->ps_pid;
+	return 0;
+}
+
+void
+pid_unalloc(pid_t pid)
+{
+	struct pidslot *ps;
+	int slot;
+
+	slot = PID_SLOT(pid);
+	ps = &pid_slots[slot];
+	KASSERT(ps->ps_pid == pid);
+	KASSERT(!ps->ps_exited);
+	KASSERT(ps->ps_firstchild == PID_NOSLOT);
+
+	if (ps->ps_parent != INVALID_PID) {
+		pid_unlink(ps->ps_parent, slot);
+	}
+	pid_freeslot(slot);
+}
+
+void
+pid_exit(pid_t pid, int status)
+{
+	struct pidslot *ps, *cs;
+	int slot, child, next;
+
+	slot = PID_SLOT(pid);
+	ps = &pid_slots[slot];
+	KASSERT(ps->ps_pid == pid);
+
+	/*
+	 * Disown the children. Those that have already exited are
+	 * waiting for us to collect them, so free them; the rest will
+	 * free themselves. Get the next link before letting go of
+	 * each one, since it may be freed and reused at once.
+	 */
+	for (child = ps->ps_firstchild; child != PID_NOSLOT; child = next) {
+		cs = &pid_slots[child];
+		next = cs->ps_nextsib;
+		cs->ps_prevsib = cs->ps_nextsib = PID_NOSLOT;
+
+		spinlock_acquire(&cs->ps_lock);
+		KASSERT(cs->ps_parent == pid);
+		if (cs->ps_exited) {
+			spinlock_release(&cs->ps_lock);
+			pid_freeslot(child);
+		}
+		else {
+			cs->ps_parent = INVALID_PID;
+			spinlock_release(&cs->ps_lock);
+		}
+	}
+	ps->ps_firstchild = PID_NOSLOT;
+
+	spinlock_acquire(&ps->ps_lock);
+	KASSERT(!ps->ps_exited);
+	if (ps->ps_parent == INVALID_PID) {
+		/* Nobody will collect us. */
+		spinlock_release(&ps->ps_lock);
+		pid_freeslot(slot);
+		return;
+	}
+	ps->ps_exited = true;
+	ps->ps_status = status;
+	wchan_wakeall(ps->ps_wchan);
+	spinlock_release(&ps->ps_lock);
+}
+
+int
+pid_wait(pid_t parent, pid_t pid, int *status, int flags, pid_t *ret)
+{
+	struct pidslot *ps;
+	int slot;
+
+	if (flags & ~WNOHANG) {
+		return EINVAL;
+	}
+	if (pid < PID_MIN || pid > PID_MAX) {
+		/* This includes WAIT_ANY and WAIT_MYPGRP. */
+		return ESRCH;
+	}
+
+	slot = PID_SLOT(pid);
+	ps = &pid_slots[slot];
+
+	spinlock_acquire(&ps->ps_lock);
+	if (ps->ps_pid != pid) {
+		spinlock_release(&ps->ps_lock);
+		return ESRCH;
+	}
+	if (ps->ps_parent != parent || parent == INVALID_PID) {
+		spinlock_release(&ps->ps_lock);
+		return ECHILD;
+	}
+	while (!ps->ps_exited) {
+		if (flags & WNOHANG) {
+			spinlock_release(&ps->ps_lock);
+			*ret = 0;
+			return 0;
+		}
+		wchan_lock(ps->ps_wchan);
+		spinlock_release(&ps->ps_lock);
+		wchan_sleep(ps->ps_wchan);
+		spinlock_acquire(&ps->ps_lock);
+	}
+	*status = ps->ps_status;
+	spinlock_release(&ps->ps_lock);
+
+	*ret = pid;
+	return 0;
+}
+
+void
+pid_reap(pid_t parent, pid_t pid)
+{
+	struct pidslot *ps;
+	int slot;
+
+	slot = PID_SLOT(pid);
+	ps = &pid_slots[slot];
+	KASSERT(ps->ps_pid == pid);
+	KASSERT(ps->ps_parent == parent);
+	KASSERT(ps->ps_exited);
+
+	/* Nobody else can touch the slot until we free it. */
+	pid_unlink(parent, slot);
+	pid_freeslot(slot);
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Waiting on many objects at once. See poll.h.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <clock.h>
+#include <timeout.h>
+#include <poll.h>
+
+////////////////////////////////////////////////////////////
+// pollqueue
+
+void
+pollqueue_init(struct pollqueue *pq)
+{
+	spinlock_init(&pq->pq_lock);
+	pq->pq_head = NULL;
+}
+
+void
+pollqueue_cleanup(struct pollqueue *pq)
+{
+	KASSERT(pq->pq_head == NULL);
+	spinlock_cleanup(&pq->pq_lock);
+}
+
+/*
+ * Mark a pollwait woken, and wake it if it is asleep.
+ */
+static
+void
+pollwait_wake(struct pollwait *pw)
+{
+	spinlock_acquire(&pw->pw_lock);
+	pw->pw_woken = true;
+	wchan_wakeall(pw->pw_wchan);
+	spinlock_release(&pw->pw_lock);
+}
+
+void
+pollqueue_wake(struct pollqueue *pq)
+{
+	struct pollentry *pe;
+
+	if (pq->pq_head == NULL) {
+		/* Nobody's polling; don't bother with the lock. */
+		return;
+	}
+
+	spinlock_acquire(&pq->pq_lock);
+	for (pe = pq->pq_head; pe != NULL; pe = pe->pe_next) {
+		pollwait_wake(pe->pe_waiter);
+	}
+	spinlock_release(&pq->pq_lock);
+}
+
+////////////////////////////////////////////////////////////
+// pollwait
+
+/*
+ * Timeout function: the time is up, so wake the poller.
+ */
+static
+void
+pollwait_timedout(void *data)
+{
+	pollwait_wake(data);
+}
+
+int
+pollwait_init(struct pollwait *pw, unsigned maxqueues, int timeout)
+{
+	struct timespec when;
+
+	pw->pw_wchan = wchan_create("poll");
+	if (pw->pw_wchan == NULL) {
+		return ENOMEM;
+	}
+	pw->pw_entries = NULL;
+	if (maxqueues > 0) {
+		pw->pw_entries = kmalloc(maxqueues * sizeof(*pw->pw_entries));
+		if (pw->pw_entries == NULL) {
+			wchan_destroy(pw->pw_wchan);
+			return ENOMEM;
+		}
+	}
+	spinlock_init(&pw->pw_lock);
+	pw->pw_woken = false;
+	pw->pw_nentries = 0;
+	pw->pw_maxentries = maxqueues;
+
+	pw->pw_timed = timeout >= 0;
+	timeout_init(&pw->pw_timeout, pollwait_timedout, pw);
+	if (pw->pw_timed) {
+		getdeadline(timeout / 1000, (timeout % 1000) * 1000000,
+			    &when);
+		timeout_add(&pw->pw_timeout, &when);
+	}
+	return 0;
+}
+
+void
+pollwait_cleanup(struct pollwait *pw)
+{
+	struct pollentry *pe;
+	struct pollqueue *pq;
+	unsigned i;
+
+	for (i=0; i<pw->pw_nentries; i++) {
+		pe = &pw->pw_entries[i];
+		pq = pe->pe_queue;
+		spinlock_acquire(&pq->pq_lock);
+		if (pe->pe_prev != NULL) {
+			pe->pe_prev->pe_next = pe->pe_next;
+		}
+		else {
+			pq->pq_head = pe->pe_next;
+		}
+		if (pe->pe_next != NULL) {
+			pe->pe_next->pe_prev = pe->pe_prev;
+		}
+		spinlock_release(&pq->pq_lock);
+	}
+
+	if (pw->pw_timed) {
+		timeout_remove(&pw->pw_timeout);
+	}
+
+	if (pw->pw_entries != NULL) {
+		kfree(pw->pw_entries);
+	}
+	spinlock_cleanup(&pw->pw_lock);
+	wchan_destroy(pw->pw_wchan);
+}
+
+void
+pollwait_register(struct pollwait *pw, struct pollqueue *pq)
+{
+	struct pollentry *pe;
+
+	if (pw == NULL) {
+		return;
+	}
+
+	KASSERT(pw->pw_nentries < pw->pw_maxentries);
+	pe = &pw->pw_entries[pw->pw_nentries++];
+	pe->pe_waiter = pw;
+	pe->pe_queue = pq;
+	pe->pe_prev = NULL;
+
+	spinlock_acquire(&pq->pq_lock);
+	pe->pe_next = pq->pq_head;
+	if (pq->pq_head != NULL) {
+		pq->pq_head->pe_prev = pe;
+	}
+	pq->pq_head = pe;
+	spinlock_release(&pq->pq_lock);
+}
+
+void
+pollwait_reset(struct pollwait *pw)
+{
+	spinlock_acquire(&pw->pw_lock);
+	pw->pw_woken = false;
+	spinlock_release(&pw->pw_lock);
+}
+
+void
+pollwait_sleep(struct pollwait *pw)
+{
+	spinlock_acquire(&pw->pw_lock);
+	if (pw->pw_woken) {
+		spinlock_release(&pw->pw_lock);
+		return;
+	}
+	wchan_lock(pw->pw_wchan);
+	spinlock_release(&pw->pw_lock);
+	wchan_sleep(pw->pw_wchan);
+}
+
+bool
+pollwait_expired(struct pollwait *pw)
+{
+	struct timespec now;
+	time_t secs;
+	uint32_t nsecs;
+
+	if (!pw->pw_timed) {
+		return false;
+	}
+	gettime(&secs, &nsecs);
+	now.tv_sec = secs;
+	now.tv_nsec = nsecs;
+	return timespec_cmp(&now, &pw->pw_timeout.to_when) >= 0;
+}
@@ -220,6 +220,24 @@ lock_acquire(struct lock *lock)
         //(void)lock;  // suppress warning until code gets written
 }
 
+bool
+lock_tryacquire(struct lock *lock)
+{
+        bool ret;
+
+        KASSERT(lock != NULL);
+        KASSERT(curthread->t_in_interrupt == false);
+
+        spinlock_acquire(&lock->lk_lock);
+        ret = lock->lk_value == 0;
+        if (ret) {
+            lock->lk_value = 1;
+            lock->lk_holder = curthread;
+        }
+        spinlock_release(&lock->lk_lock);
+        return ret;
+}
+
 void
 lock_release(struct lock *lock)
 {
@@ -332,6 +350,25 @@ cv_broadcast(struct cv *cv, struct lock *lock)
 	(void)lock;  // suppress warning until code gets written
 }
 
+int
+cv_wait_timeout(struct cv *cv, struct lock *lock,
+		const struct timespec *deadline)
+{
+	int result;
+
+	KASSERT(cv != NULL && lock != NULL);
+
+	/*
+	 * Lock the channel before letting go of the lock, so a signal
+	 * sent in between isn't lost.
+	 */
+	wchan_lock(cv->cv_wchan);
+	lock_release(lock);
+	result = wchan_sleep_timeout(cv->cv_wchan, deadline);
+	lock_acquire(lock);
+	return result;
+}
+
 
 ////////////////////////////////////////////////////////////
 // my_threadlist
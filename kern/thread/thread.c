@@ -33,6 +33,7 @@
 
 #include <types.h>
 #include <kern/errno.h>
+#include <kern/wait.h>
 #include <lib.h>
 #include <array.h>
 #include <cpu.h>
@@ -46,7 +47,11 @@
 #include <synch.h>
 #include <addrspace.h>
 #include <mainbus.h>
+#include <clock.h>
 #include <vnode.h>
+#include <file.h>
+#include <pid.h>
+#include <timeout.h>
 
 #include "opt-synchprobs.h"
 #include "opt-defaultscheduler.h"
@@ -110,26 +115,24 @@ thread_checkstack(struct thread *thread)
 }
 
 /*
- * Create a thread. This is used both to create a first thread
- * for each CPU and to create subsequent forked threads.
+ * Initialize a thread structure, new or recycled. Everything but the
+ * stack, which the caller sets up, is set to a fresh state.
  */
 static
-struct thread *
-thread_create(const char *name)
+int
+thread_init(struct thread *thread, const char *name)
 {
-	struct thread *thread;
-
 	DEBUGASSERT(name != NULL);
 
-	thread = kmalloc(sizeof(*thread));
-	if (thread == NULL) {
-		return NULL;
+	if (strlen(name) < sizeof(thread->t_namebuf)) {
+		strcpy(thread->t_namebuf, name);
+		thread->t_name = thread->t_namebuf;
 	}
-
-	thread->t_name = kstrdup(name);
-	if (thread->t_name == NULL) {
-		kfree(thread);
-		return NULL;
+	else {
+		thread->t_name = kstrdup(name);
+		if (thread->t_name == NULL) {
+			return ENOMEM;
+		}
 	}
 	thread->t_wchan_name = "NEW";
 	thread->t_state = S_READY;
@@ -137,10 +140,14 @@ thread_create(const char *name)
 	/* Thread subsystem fields */
 	thread_machdep_init(&thread->t_machdep);
 	threadlistnode_init(&thread->t_listnode, thread);
-	thread->t_stack = NULL;
 	thread->t_context = NULL;
 	thread->t_cpu = NULL;
 
+	/* Scheduler fields; new threads start at the top */
+	thread->t_priority = 0;
+	thread->t_ticks = 0;
+	thread->t_queuedat = 0;
+
 	/* Interrupt state fields */
 	thread->t_in_interrupt = false;
 	thread->t_curspl = IPL_HIGH;
@@ -151,12 +158,108 @@ thread_create(const char *name)
 
 	/* VFS fields */
 	thread->t_cwd = NULL;
+	thread->t_filetable = NULL;
+
+	/* Process fields */
+	thread->t_pid = INVALID_PID;
+	thread->t_exitstatus = _MKWAIT_EXIT(0);
 
 	/* If you add to struct thread, be sure to initialize here */
 
+	return 0;
+}
+
+/*
+ * Create a thread. This is used both to create a first thread
+ * for each CPU and to create subsequent forked threads.
+ */
+static
+struct thread *
+thread_create(const char *name)
+{
+	struct thread *thread;
+
+	thread = kmalloc(sizeof(*thread));
+	if (thread == NULL) {
+		return NULL;
+	}
+	thread->t_stack = NULL;
+
+	if (thread_init(thread, name)) {
+		kfree(thread);
+		return NULL;
+	}
 	return thread;
 }
 
+/*
+ * Thread cache.
+ *
+ * Forking and reaping threads is common, and going to kmalloc for
+ * the thread structure and its stack each time means taking the
+ * global kmalloc lock twice in each direction. Instead each cpu keeps
+ * up to THREAD_CACHE_MAX dead threads, stacks attached, on
+ * c_threadcache, and thread_fork takes one from there when it can.
+ *
+ * The stack guard band is checked when a thread goes into the cache
+ * rather than rewritten when it comes out: if it was intact then,
+ * nothing has touched it since, so only brand new stacks need
+ * thread_checkstack_init.
+ *
+ * The cache is per-cpu, so needs no lock, only interrupts off to
+ * keep us on the same cpu while we use it.
+ */
+
+#define THREAD_CACHE_MAX	8
+
+/*
+ * Take a thread from the current cpu's cache, or return NULL if it
+ * is empty. The thread has a stack, and needs thread_init.
+ */
+static
+struct thread *
+thread_cache_get(void)
+{
+	struct thread *thread;
+	int spl;
+
+	spl = splhigh();
+	thread = threadlist_remhead(&curcpu->c_threadcache);
+	splx(spl);
+
+	if (thread != NULL) {
+		KASSERT(thread->t_stack != NULL);
+		threadlistnode_cleanup(&thread->t_listnode);
+	}
+	return thread;
+}
+
+/*
+ * Put a destroyed thread in the current cpu's cache, if it has room
+ * and the thread has a stack. Returns true if it took the thread.
+ */
+static
+bool
+thread_cache_put(struct thread *thread)
+{
+	bool ret;
+	int spl;
+
+	if (thread->t_stack == NULL || !CURCPU_EXISTS()) {
+		return false;
+	}
+	thread_checkstack(thread);
+
+	spl = splhigh();
+	ret = curcpu->c_threadcache.tl_count < THREAD_CACHE_MAX;
+	if (ret) {
+		threadlistnode_init(&thread->t_listnode, thread);
+		threadlist_addhead(&curcpu->c_threadcache, thread);
+	}
+	splx(spl);
+	return ret;
+}
+
 /*
  * Create a CPU structure. This is used for the bootup CPU and
  * also for secondary CPUs.
@@ -170,6 +273,7 @@ cpu_create(unsigned hardware_number)
 {
 	struct cpu *c;
 	int result;
+	unsigned i;
 	char namebuf[16];
 
 	c = kmalloc(sizeof(*c));
@@ -182,10 +286,15 @@ cpu_create(unsigned hardware_number)
 
 	c->c_curthread = NULL;
 	threadlist_init(&c->c_zombies);
+	threadlist_init(&c->c_threadcache);
 	c->c_hardclocks = 0;
+	c->c_stealseed = hardware_number + 1;
 
 	c->c_isidle = false;
-	threadlist_init(&c->c_runqueue);
+	c->c_timerticks = 1;
+	for (i=0; i<RUNQUEUE_NLEVELS; i++) {
+		threadlist_init(&c->c_runqueue[i]);
+	}
 	spinlock_init(&c->c_runqueue_lock);
 
 	c->c_ipi_pending = 0;
@@ -248,21 +357,31 @@ thread_destroy(struct thread *thread)
 
 	/* VFS fields, cleaned up in thread_exit */
 	KASSERT(thread->t_cwd == NULL);
+	KASSERT(thread->t_filetable == NULL);
+	KASSERT(thread->t_pid == INVALID_PID);
 
 	/* VM fields, cleaned up in thread_exit */
 	KASSERT(thread->t_addrspace == NULL);
 
 	/* Thread subsystem fields */
-	if (thread->t_stack != NULL) {
-		kfree(thread->t_stack);
-	}
 	threadlistnode_cleanup(&thread->t_listnode);
 	thread_machdep_cleanup(&thread->t_machdep);
 
 	/* sheer paranoia */
 	thread->t_wchan_name = "DESTROYED";
 
-	kfree(thread->t_name);
+	if (thread->t_name != thread->t_namebuf) {
+		kfree(thread->t_name);
+	}
+	thread->t_name = NULL;
+
+	/* Keep it (and its stack) for reuse if we can */
+	if (thread_cache_put(thread)) {
+		return;
+	}
+	if (thread->t_stack != NULL) {
+		kfree(thread->t_stack);
+	}
 	kfree(thread);
 }
 
@@ -293,6 +412,8 @@ exorcise(void)
 void
 thread_panic(void)
 {
+	unsigned i;
+
 	/*
 	 * Kill off other CPUs.
 	 *
@@ -307,9 +428,11 @@ thread_panic(void)
 	 * to.  Instead, blat the list structure by hand, and take the
 	 * risk that it might not be quite atomic.
 	 */
-	curcpu->c_runqueue.tl_count = 0;
-	curcpu->c_runqueue.tl_head.tln_next = NULL;
-	curcpu->c_runqueue.tl_tail.tln_prev = NULL;
+	for (i=0; i<RUNQUEUE_NLEVELS; i++) {
+		curcpu->c_runqueue[i].tl_count = 0;
+		curcpu->c_runqueue[i].tl_head.tln_next = NULL;
+		curcpu->c_runqueue[i].tl_tail.tln_prev = NULL;
+	}
 
 	/*
 	 * Ideally, we want to make sure sleeping threads don't wake
@@ -427,6 +550,285 @@ thread_start_cpus(void)
 	cpu_startup_sem = NULL;
 }
 
+/*
+ * Run queue operations. Each cpu has one queue per priority level,
+ * and the next thread to run comes from the highest level (lowest
+ * number) that has any. The caller must hold the cpu's run queue
+ * lock.
+ */
+
+/* Add T at the tail of its level. */
+static
+void
+runqueue_add(struct cpu *c, struct thread *t)
+{
+	KASSERT(t->t_priority < RUNQUEUE_NLEVELS);
+	t->t_queuedat = c->c_hardclocks;
+	threadlist_addtail(&c->c_runqueue[t->t_priority], t);
+}
+
+/* Take the next thread to run, or NULL if there are none. */
+static
+struct thread *
+runqueue_remhead(struct cpu *c)
+{
+	unsigned i;
+
+	for (i=0; i<RUNQUEUE_NLEVELS; i++) {
+		if (!threadlist_isempty(&c->c_runqueue[i])) {
+			return threadlist_remhead(&c->c_runqueue[i]);
+		}
+	}
+	return NULL;
+}
+
+
+/* Check if any thread of priority PRIORITY or higher is waiting. */
+static
+bool
+runqueue_hasready(struct cpu *c, unsigned priority)
+{
+	unsigned i;
+
+	for (i=0; i<=priority && i<RUNQUEUE_NLEVELS; i++) {
+		if (!threadlist_isempty(&c->c_runqueue[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Work stealing.
+ *
+ * A cpu that runs out of threads looks for a busy cpu with threads
+ * waiting and takes one, rather than idling; so load balances the
+ * moment a cpu would otherwise go idle, and a cpu with nothing to
+ * spare costs nothing. Victims are tried in an order that starts at
+ * a random cpu, so idle cpus don't all pile onto the same one.
+ *
+ * The thread taken is the one at the tail of the lowest non-empty
+ * level: it would run last on the victim anyway, and low-priority
+ * threads are batch jobs that care least about losing their cache.
+ * A thread that was queued on the victim less than STEAL_MINWAIT of
+ * the victim's hardclocks ago is left alone; it will probably run
+ * there soon, with its cache still warm, and it keeps a thread that
+ * has just been stolen or woken from bouncing between cpus.
+ */
+
+#define STEAL_MINWAIT	1
+
+/* Cheap per-cpu pseudo-random cpu number, to start scanning from. */
+static
+unsigned
+steal_randomcpu(unsigned numcpus)
+{
+	curcpu->c_stealseed = curcpu->c_stealseed * 1103515245 + 12345;
+	return (curcpu->c_stealseed >> 16) % numcpus;
+}
+
+/*
+ * Take a thread from victim C's run queue for the current cpu, or
+ * return NULL if it has none worth taking. The caller must hold C's
+ * run queue lock.
+ */
+static
+struct thread *
+runqueue_steal(struct cpu *c)
+{
+	struct thread *t;
+	struct threadlist *tl;
+	unsigned i;
+
+	for (i=RUNQUEUE_NLEVELS; i-- > 0; ) {
+		tl = &c->c_runqueue[i];
+		if (threadlist_isempty(tl)) {
+			continue;
+		}
+		t = tl->tl_tail.tln_prev->tln_self;
+
+		/*
+		 * The victim's curthread can be on its run queue if
+		 * it went to sleep, the victim idled, and it was
+		 * woken before the victim got going again. Taking
+		 * it would be a disaster.
+		 */
+		if (t == c->c_curthread) {
+			return NULL;
+		}
+		if (c->c_hardclocks - t->t_queuedat < STEAL_MINWAIT) {
+			return NULL;
+		}
+		return threadlist_remtail(tl);
+	}
+	return NULL;
+}
+
+/*
+ * Look for a thread to steal. Called by a cpu with an empty run
+ * queue, not holding its run queue lock. The thread returned is on
+ * no run queue, and now belongs to the current cpu.
+ */
+static
+struct thread *
+thread_steal(void)
+{
+	struct cpu *c;
+	struct thread *t;
+	unsigned numcpus, start, i;
+
+	numcpus = cpuarray_num(&allcpus);
+	if (numcpus < 2) {
+		return NULL;
+	}
+	start = steal_randomcpu(numcpus);
+
+	for (i=0; i<numcpus; i++) {
+		c = cpuarray_get(&allcpus, (start + i) % numcpus);
+
+		/*
+		 * Skip ourselves, idle cpus (which are about to run
+		 * their own threads), and cpus with nothing queued.
+		 * These checks are unlocked and only hints.
+		 */
+		if (c == curcpu->c_self || c->c_isidle ||
+		    !runqueue_hasready(c, RUNQUEUE_NLEVELS - 1)) {
+			continue;
+		}
+
+		spinlock_acquire(&c->c_runqueue_lock);
+		t = runqueue_steal(c);
+		spinlock_release(&c->c_runqueue_lock);
+
+		if (t != NULL) {
+			t->t_cpu = curcpu->c_self;
+			DEBUG(DB_THREADS, "Stole thread %s: cpu %u -> %u\n",
+			      t->t_name, c->c_number, curcpu->c_number);
+			return t;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Tickless operation.
+ *
+ * A cpu only needs hardclock while more than one thread wants it. An
+ * idle cpu sets its timer as far out as allowed and sleeps until an
+ * interrupt gives it something to do; a cpu running one thread with
+ * nothing waiting stretches its tick, since there is nobody to
+ * preempt for. As soon as a thread is queued behind the running one
+ * the cpu goes back to ticking every 1/HZ.
+ *
+ * c_timerticks records how far out the timer is set, so hardclock
+ * can keep c_hardclocks in step with real ticks. When the timer is
+ * brought back in early, the ticks that have gone by so far are
+ * counted then.
+ *
+ * With idle cpus no longer waking up each tick to try stealing, a
+ * busy cpu that has threads waiting pokes an idle one on each of its
+ * ticks instead.
+ */
+
+/*
+ * Set the current cpu's timer for NTICKS, counting the ticks that have
+ * gone by since it was last set, if the stretched tick is cut short.
+ */
+static
+void
+thread_settimer(unsigned nticks)
+{
+	unsigned elapsed;
+
+	elapsed = mainbus_settimer(nticks);
+	if (elapsed >= curcpu->c_timerticks) {
+		/* The interrupt is pending; hardclock will count it. */
+		elapsed = 0;
+	}
+	curcpu->c_hardclocks += elapsed;
+	curcpu->c_timerticks = nticks;
+}
+
+/*
+ * Bring the current cpu's timer in if it is running a thread and is
+ * set further out than that allows: every hardclock if others are
+ * waiting, ALONE_HARDCLOCKS otherwise (which matters when it has
+ * just stopped idling). Call with its run queue lock held.
+ */
+static
+void
+thread_checktick(void)
+{
+	unsigned nticks;
+
+	KASSERT(spinlock_do_i_hold(&curcpu->c_runqueue_lock));
+
+	if (curcpu->c_isidle) {
+		return;
+	}
+	nticks = runqueue_hasready(curcpu, RUNQUEUE_NLEVELS - 1) ?
+		1 : ALONE_HARDCLOCKS;
+	if (curcpu->c_timerticks > nticks) {
+		thread_settimer(nticks);
+	}
+}
+
+/*
+ * Interrupt one idle cpu, if there is one, so it wakes up and steals
+ * from the current cpu.
+ */
+static
+void
+thread_kickidle(void)
+{
+	struct cpu *c;
+	unsigned numcpus, start, i;
+
+	numcpus = cpuarray_num(&allcpus);
+	if (numcpus < 2) {
+		return;
+	}
+	start = steal_randomcpu(numcpus);
+
+	for (i=0; i<numcpus; i++) {
+		c = cpuarray_get(&allcpus, (start + i) % numcpus);
+		/* Unlocked hint, as in thread_steal. */
+		if (c != curcpu->c_self && c->c_isidle) {
+			ipi_send(c, IPI_UNIDLE);
+			return;
+		}
+	}
+}
+
+/*
+ * Set the current cpu's timer for its next hardclock; see thread.h.
+ */
+unsigned
+thread_nextclock(void)
+{
+	unsigned nticks;
+	bool hasready;
+
+	spinlock_acquire(&curcpu->c_runqueue_lock);
+	hasready = runqueue_hasready(curcpu, RUNQUEUE_NLEVELS - 1);
+	if (curcpu->c_isidle) {
+		nticks = IDLE_HARDCLOCKS;
+	}
+	else if (hasready) {
+		nticks = 1;
+	}
+	else {
+		nticks = ALONE_HARDCLOCKS;
+	}
+	thread_settimer(nticks);
+	spinlock_release(&curcpu->c_runqueue_lock);
+
+	if (hasready && !curcpu->c_isidle) {
+		thread_kickidle();
+	}
+	return nticks;
+}
+
 /*
  * Make a thread runnable.
  *
@@ -451,7 +853,7 @@ thread_make_runnable(struct thread *target, bool already_have_lock)
 	}
 
 	isidle = targetcpu->c_isidle;
-	threadlist_addtail(&targetcpu->c_runqueue, target);
+	runqueue_add(targetcpu, target);
 	if (isidle) {
 		/*
 		 * Other processor is idle; send interrupt to make
@@ -459,6 +861,17 @@ thread_make_runnable(struct thread *target, bool already_have_lock)
 		 */
 		ipi_send(targetcpu, IPI_UNIDLE);
 	}
+	else if (targetcpu == curcpu->c_self) {
+		thread_checktick();
+	}
+	else if (targetcpu->c_timerticks > 1) {
+		/*
+		 * Other processor is running with its clock
+		 * stretched; the interrupt makes it tick again so
+		 * the new thread gets its turn.
+		 */
+		ipi_send(targetcpu, IPI_UNIDLE);
+	}
 
 	if (!already_have_lock) {
 		spinlock_release(&targetcpu->c_runqueue_lock);
@@ -484,18 +897,29 @@ thread_fork(const char *name,
 {
 	struct thread *newthread;
 
-	newthread = thread_create(name);
-	if (newthread == NULL) {
-		return ENOMEM;
+	/* Recycle a dead thread, stack and all, if we have one */
+	newthread = thread_cache_get();
+	if (newthread != NULL) {
+		if (thread_init(newthread, name)) {
+			kfree(newthread->t_stack);
+			kfree(newthread);
+			return ENOMEM;
+		}
 	}
+	else {
+		newthread = thread_create(name);
+		if (newthread == NULL) {
+			return ENOMEM;
+		}
 
-	/* Allocate a stack */
-	newthread->t_stack = kmalloc(STACK_SIZE);
-	if (newthread->t_stack == NULL) {
-		thread_destroy(newthread);
-		return ENOMEM;
+		/* Allocate a stack */
+		newthread->t_stack = kmalloc(STACK_SIZE);
+		if (newthread->t_stack == NULL) {
+			thread_destroy(newthread);
+			return ENOMEM;
+		}
+		thread_checkstack_init(newthread);
 	}
-	thread_checkstack_init(newthread);
 
 	/*
 	 * Now we clone various fields from the parent thread.
@@ -578,8 +1002,12 @@ thread_switch(threadstate_t newstate, struct wchan *wc)
 	/* Lock the run queue. */
 	spinlock_acquire(&curcpu->c_runqueue_lock);
 
-	/* Micro-optimization: if nothing to do, just return */
-	if (newstate == S_READY && threadlist_isempty(&curcpu->c_runqueue)) {
+	/*
+	 * Micro-optimization: if nothing to do, just return. When
+	 * yielding, that means nothing at our priority or higher.
+	 */
+	if (newstate == S_READY &&
+	    !runqueue_hasready(curcpu, cur->t_priority)) {
 		spinlock_release(&curcpu->c_runqueue_lock);
 		splx(spl);
 		return;
@@ -593,6 +1021,16 @@ thread_switch(threadstate_t newstate, struct wchan *wc)
 		thread_make_runnable(cur, true /*have lock*/);
 		break;
 	    case S_SLEEP:
+#if !OPT_DEFAULTSCHEDULER
+		/*
+		 * Giving up the cpu to wait for something is what
+		 * interactive threads do; move up a level.
+		 */
+		if (cur->t_priority > 0) {
+			cur->t_priority--;
+		}
+		cur->t_ticks = 0;
+#endif
 		cur->t_wchan_name = wc->wc_name;
 		/*
 		 * Add the thread to the list in the wait channel, and
@@ -618,11 +1056,14 @@ thread_switch(threadstate_t newstate, struct wchan *wc)
 	cur->t_state = newstate;
 
 	/*
-	 * Get the next thread. While there isn't one, call md_idle().
+	 * Get the next thread. While there isn't one, call md_idle(),
+	 * first giving the VM system a chance to do background work.
 	 * curcpu->c_isidle must be true when md_idle is
 	 * called. Unlock the runqueue while idling too, to make sure
 	 * things can be added to it.
 	 *
+	 * Before idling, try to steal a thread from a busier cpu.
+	 *
 	 * Note that we don't need to unlock the runqueue atomically
 	 * with idling; becoming unidle requires receiving an
 	 * interrupt (either a hardware interrupt or an interprocessor
@@ -637,14 +1078,19 @@ thread_switch(threadstate_t newstate, struct wchan *wc)
 	/* The current cpu is now idle. */
 	curcpu->c_isidle = true;
 	do {
-		next = threadlist_remhead(&curcpu->c_runqueue);
+		next = runqueue_remhead(curcpu);
 		if (next == NULL) {
 			spinlock_release(&curcpu->c_runqueue_lock);
-			cpu_idle();
+			next = thread_steal();
+			if (next == NULL) {
+				vm_idle();
+				cpu_idle();
+			}
 			spinlock_acquire(&curcpu->c_runqueue_lock);
 		}
 	} while (next == NULL);
 	curcpu->c_isidle = false;
+	thread_checktick();
 
 	/*
 	 * Note that curcpu->c_curthread may be the same variable as
@@ -798,6 +1244,10 @@ thread_exit(void)
 		VOP_DECREF(cur->t_cwd);
 		cur->t_cwd = NULL;
 	}
+	if (cur->t_filetable) {
+		filetable_destroy(cur->t_filetable);
+		cur->t_filetable = NULL;
+	}
 
 	/* VM fields */
 	if (cur->t_addrspace) {
@@ -813,6 +1263,16 @@ thread_exit(void)
 		as_destroy(as);
 	}
 
+	/*
+	 * Process fields. Do this last, so that by the time the
+	 * parent collects our exit status, our files are closed and
+	 * our memory is freed.
+	 */
+	if (cur->t_pid != INVALID_PID) {
+		pid_exit(cur->t_pid, cur->t_exitstatus);
+		cur->t_pid = INVALID_PID;
+	}
+
 	/* Check the stack guard band. */
 	thread_checkstack(cur);
 
@@ -836,146 +1296,93 @@ thread_yield(void)
 /*
  * Scheduler.
  *
- * This is called periodically from hardclock(). It should reshuffle
- * the current CPU's run queue by job priority.
+ * The default scheduler is plain round-robin: every thread stays at
+ * priority 0 and the current thread yields on every clock tick.
+ *
+ * Otherwise we have a multi-level feedback queue. A thread runs for
+ * a quantum that doubles with each level down, and a thread that
+ * uses up its quantum is CPU-bound and moves down a level, while one
+ * that goes to sleep first is interactive and moves up a level. So
+ * threads like sh and conman that mostly wait for input stay near
+ * the top and get the cpu as soon as they wake, and batch jobs like
+ * hog sink to the bottom and run in longer slices when nothing else
+ * wants the cpu. A thread is preempted early if anything of higher
+ * priority is waiting. To keep low-priority threads from starving,
+ * schedule() periodically moves the longest-waiting thread on each
+ * level up one.
  */
 
 #if OPT_DEFAULTSCHEDULER
 void
-schedule(void)
+thread_tick(void)
 {
-  // 28 Feb 2012 : GWA : Leave the default scheduler alone!
+	thread_yield();
 }
-#else
+
 void
 schedule(void)
 {
-  // 28 Feb 2012 : GWA : Implement your scheduler that prioritizes
-  // "interactive" threads here.
+  // 28 Feb 2012 : GWA : Leave the default scheduler alone!
 }
-#endif
+#else
+
+/* Hardclocks in a quantum at LEVEL. */
+#define THREAD_QUANTUM(level)	(1U << (level))
 
-/*
- * Thread migration.
- *
- * This is also called periodically from hardclock(). If the current
- * CPU is busy and other CPUs are idle, or less busy, it should move
- * threads across to those other other CPUs.
- *
- * Migrating threads isn't free because of cache affinity; a thread's
- * working cache set will end up having to be moved to the other CPU,
- * which is fairly slow. The tradeoff between this performance loss
- * and the performance loss due to underutilization of some CPUs is
- * something that needs to be tuned and probably is workload-specific.
- *
- * For here and now, because we know we're running on System/161 and
- * System/161 does not (yet) model such cache effects, we'll be very
- * aggressive.
- */
 void
-thread_consider_migration(void)
+thread_tick(void)
 {
-	unsigned my_count, total_count, one_share, to_send;
-	unsigned i, numcpus;
-	struct cpu *c;
-	struct threadlist victims;
-	struct thread *t;
-
-	my_count = total_count = 0;
-	numcpus = cpuarray_num(&allcpus);
-	for (i=0; i<numcpus; i++) {
-		c = cpuarray_get(&allcpus, i);
-		spinlock_acquire(&c->c_runqueue_lock);
-		total_count += c->c_runqueue.tl_count;
-		if (c == curcpu->c_self) {
-			my_count = c->c_runqueue.tl_count;
-		}
-		spinlock_release(&c->c_runqueue_lock);
-	}
+	struct thread *cur;
+	bool preempt;
 
-	one_share = DIVROUNDUP(total_count, numcpus);
-	if (my_count < one_share) {
+	cur = curthread;
+	if (curcpu->c_isidle) {
 		return;
 	}
 
-	to_send = my_count - one_share;
-	threadlist_init(&victims);
-	spinlock_acquire(&curcpu->c_runqueue_lock);
-	for (i=0; i<to_send; i++) {
-		t = threadlist_remtail(&curcpu->c_runqueue);
-		threadlist_addhead(&victims, t);
-	}
-	spinlock_release(&curcpu->c_runqueue_lock);
-
-	for (i=0; i < numcpus && to_send > 0; i++) {
-		c = cpuarray_get(&allcpus, i);
-		if (c == curcpu->c_self) {
-			continue;
-		}
-		spinlock_acquire(&c->c_runqueue_lock);
-		while (c->c_runqueue.tl_count < one_share && to_send > 0) {
-			t = threadlist_remhead(&victims);
-			/*
-			 * Ordinarily, curthread will not appear on
-			 * the run queue. However, it can under the
-			 * following circumstances:
-			 *   - it went to sleep;
-			 *   - the processor became idle, so it
-			 *     remained curthread;
-			 *   - it was reawakened, so it was put on the
-			 *     run queue;
-			 *   - and the processor hasn't fully unidled
-			 *     yet, so all these things are still true.
-			 *
-			 * If the timer interrupt happens at (almost)
-			 * exactly the proper moment, we can come here
-			 * while things are in this state and see
-			 * curthread. However, *migrating* curthread
-			 * can cause bad things to happen (Exercise:
-			 * Why? And what?) so shuffle it to the end of
-			 * the list and decrement to_send in order to
-			 * skip it. Then it goes back on our own run
-			 * queue below.
-			 */
-			if (t == curthread) {
-				threadlist_addtail(&victims, t);
-				to_send--;
-				continue;
-			}
-
-			t->t_cpu = c;
-			threadlist_addtail(&c->c_runqueue, t);
-			DEBUG(DB_THREADS,
-			      "Migrated thread %s: cpu %u -> %u",
-			      t->t_name, curcpu->c_number, c->c_number);
-			to_send--;
-			if (c->c_isidle) {
-				/*
-				 * Other processor is idle; send
-				 * interrupt to make sure it unidles.
-				 */
-				ipi_send(c, IPI_UNIDLE);
-			}
+	cur->t_ticks++;
+	if (cur->t_ticks >= THREAD_QUANTUM(cur->t_priority)) {
+		if (cur->t_priority < RUNQUEUE_NLEVELS - 1) {
+			cur->t_priority++;
 		}
-		spinlock_release(&c->c_runqueue_lock);
+		cur->t_ticks = 0;
+		thread_yield();
+		return;
 	}
 
-	/*
-	 * Because the code above isn't atomic, the thread counts may have
-	 * changed while we were working and we may end up with leftovers.
-	 * Don't panic; just put them back on our own run queue.
-	 */
-	if (!threadlist_isempty(&victims)) {
+	if (cur->t_priority > 0) {
 		spinlock_acquire(&curcpu->c_runqueue_lock);
-		while ((t = threadlist_remhead(&victims)) != NULL) {
-			threadlist_addtail(&curcpu->c_runqueue, t);
-		}
+		preempt = runqueue_hasready(curcpu, cur->t_priority - 1);
 		spinlock_release(&curcpu->c_runqueue_lock);
+		if (preempt) {
+			thread_yield();
+		}
 	}
+}
+
+/*
+ * This is called periodically from hardclock(). Age the run queue:
+ * move the thread at the head of each level but the top, which has
+ * waited there longest, to the tail of the level above.
+ */
+void
+schedule(void)
+{
+	struct thread *t;
+	unsigned i;
 
-	KASSERT(threadlist_isempty(&victims));
-	threadlist_cleanup(&victims);
+	spinlock_acquire(&curcpu->c_runqueue_lock);
+	for (i=1; i<RUNQUEUE_NLEVELS; i++) {
+		t = threadlist_remhead(&curcpu->c_runqueue[i]);
+		if (t != NULL) {
+			KASSERT(t->t_priority == i);
+			t->t_priority = i - 1;
+			runqueue_add(curcpu, t);
+		}
+	}
+	spinlock_release(&curcpu->c_runqueue_lock);
 }
+#endif
 
 ////////////////////////////////////////////////////////////
 
@@ -1048,6 +1455,74 @@ wchan_sleep(struct wchan *wc)
 	thread_switch(S_SLEEP, wc);
 }
 
+/*
+ * State for a timed sleep, on the sleeper's stack.
+ */
+struct wchan_timedsleep {
+	struct wchan *wts_wchan;	/* channel slept on */
+	struct thread *wts_thread;	/* the sleeper */
+	bool wts_expired;		/* the timeout woke it */
+};
+
+/*
+ * Timeout function for wchan_sleep_timeout: if the thread is still
+ * asleep, take it off the channel and wake it.
+ */
+static
+void
+wchan_timedout(void *data)
+{
+	struct wchan_timedsleep *wts = data;
+	struct wchan *wc = wts->wts_wchan;
+	struct threadlistnode *tln;
+
+	spinlock_acquire(&wc->wc_lock);
+	for (tln = wc->wc_threads.tl_head.tln_next; tln->tln_next != NULL;
+	     tln = tln->tln_next) {
+		if (tln->tln_self == wts->wts_thread) {
+			threadlist_remove(&wc->wc_threads, wts->wts_thread);
+			wts->wts_expired = true;
+			break;
+		}
+	}
+	spinlock_release(&wc->wc_lock);
+
+	if (wts->wts_expired) {
+		thread_make_runnable(wts->wts_thread, false);
+	}
+}
+
+/*
+ * Like wchan_sleep, but give up at DEADLINE. The channel must be
+ * locked, and will be *unlocked* upon return.
+ */
+int
+wchan_sleep_timeout(struct wchan *wc, const struct timespec *deadline)
+{
+	struct wchan_timedsleep wts;
+	struct timeout to;
+
+	/* may not sleep in an interrupt handler */
+	KASSERT(!curthread->t_in_interrupt);
+	KASSERT(spinlock_do_i_hold(&wc->wc_lock));
+
+	wts.wts_wchan = wc;
+	wts.wts_thread = curthread;
+	wts.wts_expired = false;
+	timeout_init(&to, wchan_timedout, &wts);
+
+	/*
+	 * Holding the channel lock keeps the timeout from getting at
+	 * the channel until we're on it.
+	 */
+	timeout_add(&to, deadline);
+	thread_switch(S_SLEEP, wc);
+
+	/* Make sure it's finished with WTS before we return. */
+	timeout_remove(&to);
+	return wts.wts_expired ? ETIMEDOUT : 0;
+}
+
 /*
  * Wake up one thread sleeping on a wait channel.
  */
@@ -1182,6 +1657,28 @@ ipi_tlbshootdown(struct cpu *target, const struct tlbshootdown *mapping)
 	spinlock_release(&target->c_ipi_lock);
 }
 
+unsigned
+ipi_tlbshootdown_cpus(uint32_t cpumask, const struct tlbshootdown *mapping)
+{
+	unsigned i, n;
+	struct cpu *c;
+
+	n = 0;
+	for (i=0; i < cpuarray_num(&allcpus); i++) {
+		c = cpuarray_get(&allcpus, i);
+		if (c == curcpu->c_self) {
+			continue;
+		}
+		if (c->c_number < 32 &&
+		    (cpumask & ((uint32_t)1 << c->c_number)) == 0) {
+			continue;
+		}
+		ipi_tlbshootdown(c, mapping);
+		n++;
+	}
+	return n;
+}
+
 void
 interprocessor_interrupt(void)
 {
@@ -1209,7 +1706,7 @@ interprocessor_interrupt(void)
 	if (bits & (1U << IPI_UNIDLE)) {
 		/*
 		 * The cpu has already unidled itself to take the
-		 * interrupt; don't need to do anything else.
+		 * interrupt; if it was busy instead, see below.
 		 */
 	}
 	if (bits & (1U << IPI_TLBSHOOTDOWN)) {
@@ -1226,4 +1723,17 @@ interprocessor_interrupt(void)
 
 	curcpu->c_ipi_pending = 0;
 	spinlock_release(&curcpu->c_ipi_lock);
+
+	if (bits & (1U << IPI_UNIDLE)) {
+		/*
+		 * A busy cpu may need its clock back for a thread
+		 * that was just queued. This takes the run queue
+		 * lock, so it must come after releasing the IPI lock:
+		 * thread_make_runnable sends IPIs with the run queue
+		 * locked.
+		 */
+		spinlock_acquire(&curcpu->c_runqueue_lock);
+		thread_checktick();
+		spinlock_release(&curcpu->c_runqueue_lock);
+	}
 }
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Timeouts. See timeout.h.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <clock.h>
+#include <timeout.h>
+
+/* Longest the timer device is ever set for; timerclock runs once a second. */
+#define TIMEOUT_MAXUSECS	1000000
+
+/*
+ * The list of pending timeouts, the one whose function is running (so
+ * timeout_remove can wait for it), and the timer device.
+ */
+static struct spinlock timeout_lock = SPINLOCK_INITIALIZER;
+static struct timeout *timeout_head;
+static struct timeout *timeout_running;
+static void (*timeout_settimer)(void *dev, uint32_t usecs);
+static void *timeout_dev;
+
+/*
+ * Set the timer device to go off when the first timeout is due. NOW
+ * is the current time. Call with timeout_lock held.
+ */
+static
+void
+timeout_program(const struct timespec *now)
+{
+	struct timespec *when;
+	uint32_t usecs;
+
+	KASSERT(spinlock_do_i_hold(&timeout_lock));
+
+	if (timeout_settimer == NULL) {
+		/* No device yet; the first timerclock will catch up. */
+		return;
+	}
+
+	usecs = TIMEOUT_MAXUSECS;
+	if (timeout_head != NULL) {
+		when = &timeout_head->to_when;
+		if (timespec_cmp(when, now) <= 0) {
+			usecs = 1;
+		}
+		else if (when->tv_sec - now->tv_sec < 2) {
+			/* Round up: a timeout must never fire early. */
+			usecs = (when->tv_sec - now->tv_sec) * 1000000
+				+ (when->tv_nsec + 999) / 1000
+				- now->tv_nsec / 1000;
+			if (usecs > TIMEOUT_MAXUSECS) {
+				usecs = TIMEOUT_MAXUSECS;
+			}
+		}
+	}
+	timeout_settimer(timeout_dev, usecs);
+}
+
+/*
+ * Get the current time as a timespec.
+ */
+static
+void
+timeout_now(struct timespec *now)
+{
+	time_t secs;
+	uint32_t nsecs;
+
+	gettime(&secs, &nsecs);
+	now->tv_sec = secs;
+	now->tv_nsec = nsecs;
+}
+
+/*
+ * Take a pending timeout off the list. Call with timeout_lock held.
+ */
+static
+void
+timeout_unlink(struct timeout *to)
+{
+	KASSERT(to->to_pending);
+
+	if (to->to_prev != NULL) {
+		to->to_prev->to_next = to->to_next;
+	}
+	else {
+		timeout_head = to->to_next;
+	}
+	if (to->to_next != NULL) {
+		to->to_next->to_prev = to->to_prev;
+	}
+	to->to_prev = to->to_next = NULL;
+	to->to_pending = false;
+}
+
+void
+timeout_init(struct timeout *to, void (*func)(void *), void *data)
+{
+	to->to_when.tv_sec = 0;
+	to->to_when.tv_nsec = 0;
+	to->to_func = func;
+	to->to_data = data;
+	to->to_pending = false;
+	to->to_prev = to->to_next = NULL;
+}
+
+void
+timeout_add(struct timeout *to, const struct timespec *when)
+{
+	struct timeout *prev, *next;
+	struct timespec now;
+
+	spinlock_acquire(&timeout_lock);
+	KASSERT(!to->to_pending);
+
+	to->to_when = *when;
+	prev = NULL;
+	for (next = timeout_head; next != NULL; next = next->to_next) {
+		if (timespec_cmp(&to->to_when, &next->to_when) < 0) {
+			break;
+		}
+		prev = next;
+	}
+	to->to_prev = prev;
+	to->to_next = next;
+	if (prev != NULL) {
+		prev->to_next = to;
+	}
+	else {
+		timeout_head = to;
+	}
+	if (next != NULL) {
+		next->to_prev = to;
+	}
+	to->to_pending = true;
+
+	/* If it's now the first one due, the device needs resetting. */
+	if (prev == NULL) {
+		timeout_now(&now);
+		timeout_program(&now);
+	}
+	spinlock_release(&timeout_lock);
+}
+
+bool
+timeout_remove(struct timeout *to)
+{
+	bool pending;
+
+	spinlock_acquire(&timeout_lock);
+	pending = to->to_pending;
+	if (pending) {
+		timeout_unlink(to);
+	}
+	else {
+		/* It might be firing right now; wait until it's done. */
+		while (timeout_running == to) {
+			spinlock_release(&timeout_lock);
+			spinlock_acquire(&timeout_lock);
+		}
+	}
+	spinlock_release(&timeout_lock);
+
+	/*
+	 * Leave the device alone if it was first; it'll go off early
+	 * and find nothing to do, which is cheaper than resetting it.
+	 */
+	return pending;
+}
+
+void
+timeout_expire(void)
+{
+	struct timeout *to;
+	struct timespec now;
+
+	spinlock_acquire(&timeout_lock);
+	if (timeout_running != NULL) {
+		/* Another cpu is already at it. */
+		spinlock_release(&timeout_lock);
+		return;
+	}
+	timeout_now(&now);
+	while (timeout_head != NULL &&
+	       timespec_cmp(&timeout_head->to_when, &now) <= 0) {
+		to = timeout_head;
+		timeout_unlink(to);
+
+		/*
+		 * Call the function without the lock, so it can take
+		 * whatever locks it needs (including ones held by
+		 * people calling timeout_add), and can add timeouts.
+		 * Once timeout_running is cleared we must not touch
+		 * TO again; its owner may have thrown it away.
+		 */
+		timeout_running = to;
+		spinlock_release(&timeout_lock);
+		to->to_func(to->to_data);
+		spinlock_acquire(&timeout_lock);
+		timeout_running = NULL;
+		timeout_now(&now);
+	}
+	timeout_program(&now);
+	spinlock_release(&timeout_lock);
+}
+
+void
+timeout_setdevice(void (*settimer)(void *dev, uint32_t usecs), void *dev)
+{
+	spinlock_acquire(&timeout_lock);
+	KASSERT(timeout_settimer == NULL);
+	timeout_settimer = settimer;
+	timeout_dev = dev;
+
+	/*
+	 * The clock for gettime is probably not attached yet, so we
+	 * can't work out when anything is due; but nothing can have
+	 * been added without it anyway. Just start the one-second
+	 * cycle.
+	 */
+	timeout_settimer(timeout_dev, TIMEOUT_MAXUSECS);
+	spinlock_release(&timeout_lock);
+}
@@ -134,6 +134,17 @@ dev_ioctl(struct vnode *v, int op, userptr_t data)
 	return d->d_ioctl(d, op, data);
 }
 
+/*
+ * Called for poll() and select(). Also pass through.
+ */
+static
+int
+dev_poll(struct vnode *v, int events, int *revents, struct pollwait *pw)
+{
+	struct device *d = v->vn_data;
+	return d->d_poll(d, events, revents, pw);
+}
+
 /*
  * Called for stat().
  * Set the type and the size (block devices only).
@@ -241,15 +252,15 @@ null_fsync(struct vnode *v)
 }
 
 /*
- * For mmap. If you want this to do anything, you have to write it
- * yourself. Some devices may not make sense to map. Others do.
+ * For mmap. Mapping goes through VOP_READ and VOP_WRITE a page at a
+ * time, which makes no sense for devices, so refuse.
  */
 static
 int
-dev_mmap(struct vnode *v  /* add stuff as needed */)
+dev_mmap(struct vnode *v)
 {
 	(void)v;
-	return EUNIMP;
+	return ENODEV;
 }
 
 /*
@@ -423,6 +434,7 @@ static const struct vnode_ops dev_vnode_ops = {
 	null_io,      /* getdirentry */
 	dev_write,
 	dev_ioctl,
+	dev_poll,
 	dev_stat,
 	dev_gettype,
 	dev_tryseek,
@@ -35,6 +35,7 @@
 #include <kern/errno.h>
 #include <lib.h>
 #include <uio.h>
+#include <poll.h>
 #include <vfs.h>
 #include <device.h>
 
@@ -93,6 +94,18 @@ nullioctl(struct device *dev, int op, userptr_t data)
 	return EINVAL;
 }
 
+/* For poll() and select(); null is always ready */
+static
+int
+nullpoll(struct device *dev, int events, int *revents, struct pollwait *pw)
+{
+	(void)dev;
+	(void)pw;
+
+	*revents = events & (POLLIN | POLLOUT);
+	return 0;
+}
+
 /*
  * Function to create and attach null:
  */
@@ -112,6 +125,7 @@ devnull_create(void)
 	dev->d_close = nullclose;
 	dev->d_io = nullio;
 	dev->d_ioctl = nullioctl;
+	dev->d_poll = nullpoll;
 
 	dev->d_blocks = 0;
 	dev->d_blocksize = 1;
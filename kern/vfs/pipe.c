@@ -0,0 +1,718 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Pipes.
+ *
+ * A pipe is a ring buffer of PIPE_SIZE bytes with a vnode for each
+ * end. p_head counts all bytes ever written and p_tail all bytes
+ * ever read, so the pipe holds p_head - p_tail bytes; only the
+ * writer changes p_head and only the reader changes p_tail. Writers
+ * are serialized among themselves by p_wlock, and readers by
+ * p_rlock, so there is only ever one of each at work and the copying
+ * in and out of the buffer needs no lock shared between them. (This
+ * relies on the cpus seeing each other's memory writes in order,
+ * which they do on System/161.) Holding p_wlock for a whole write
+ * also makes every write atomic, not just those up to PIPE_BUF.
+ *
+ * p_lock protects the rest: the waiting and closed flags. A side
+ * that cannot make progress sets its waiting flag and sleeps on its
+ * wchan; the flags are checked again under p_lock before sleeping,
+ * so wakeups can't be lost. Wakeups are batched: the other side is
+ * woken only when it is waiting and the buffer has crossed
+ * PIPE_WAKEMARK, or when this side is about to block, or at the end
+ * of the read or write. The waiting flags are checked without p_lock
+ * before it is taken, so a stream of writes into a pipe whose reader
+ * keeps up costs no lock traffic at all, and a big write costs a few
+ * context switches, not one per buffer's worth.
+ *
+ * Pollers register on p_rpollq (read end) or p_wpollq (write end),
+ * and are woken whenever the reader or writer would be: at the end
+ * of each read or write, before either side blocks, and on close.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <stat.h>
+#include <spinlock.h>
+#include <synch.h>
+#include <wchan.h>
+#include <uio.h>
+#include <poll.h>
+#include <vnode.h>
+#include <vm.h>
+#include <pipe.h>
+
+/* Buffer size. Must be a power of 2. */
+#define PIPE_SIZE	PAGE_SIZE
+#define PIPE_MASK	(PIPE_SIZE - 1)
+
+/* Wake the other side mid-transfer once this much is ready for it. */
+#define PIPE_WAKEMARK	(PIPE_SIZE / 2)
+
+struct pipe {
+	struct vnode p_rvnode;		/* read end */
+	struct vnode p_wvnode;		/* write end */
+	char *p_buf;			/* ring buffer */
+	volatile unsigned p_head;	/* bytes written; writer only */
+	volatile unsigned p_tail;	/* bytes read; reader only */
+	struct lock *p_rlock;		/* one reader at a time */
+	struct lock *p_wlock;		/* one writer at a time */
+
+	struct spinlock p_lock;		/* protects the following */
+	struct wchan *p_rwchan;		/* reader waits here */
+	struct wchan *p_wwchan;		/* writer waits here */
+	volatile bool p_rwaiting;	/* reader is asleep */
+	volatile bool p_wwaiting;	/* writer is asleep */
+	volatile bool p_rclosed;	/* read end closed */
+	volatile bool p_wclosed;	/* write end closed */
+	unsigned p_nends;		/* ends not yet reclaimed */
+
+	struct pollqueue p_rpollq;	/* pollers of the read end */
+	struct pollqueue p_wpollq;	/* pollers of the write end */
+};
+
+static const struct vnode_ops pipe_vnode_ops;
+
+////////////////////////////////////////////////////////////
+// creation and destruction
+
+static
+void
+pipe_destroy(struct pipe *p)
+{
+	if (p->p_wwchan != NULL) {
+		wchan_destroy(p->p_wwchan);
+	}
+	if (p->p_rwchan != NULL) {
+		wchan_destroy(p->p_rwchan);
+	}
+	pollqueue_cleanup(&p->p_wpollq);
+	pollqueue_cleanup(&p->p_rpollq);
+	spinlock_cleanup(&p->p_lock);
+	if (p->p_wlock != NULL) {
+		lock_destroy(p->p_wlock);
+	}
+	if (p->p_rlock != NULL) {
+		lock_destroy(p->p_rlock);
+	}
+	if (p->p_buf != NULL) {
+		kfree(p->p_buf);
+	}
+	kfree(p);
+}
+
+int
+pipe_create(struct vnode **readend, struct vnode **writeend)
+{
+	struct pipe *p;
+	int result;
+
+	p = kmalloc(sizeof(*p));
+	if (p == NULL) {
+		return ENOMEM;
+	}
+	p->p_buf = kmalloc(PIPE_SIZE);
+	p->p_head = p->p_tail = 0;
+	p->p_rlock = lock_create("pipe-read");
+	p->p_wlock = lock_create("pipe-write");
+	spinlock_init(&p->p_lock);
+	p->p_rwchan = wchan_create("pipe-read");
+	p->p_wwchan = wchan_create("pipe-write");
+	p->p_rwaiting = p->p_wwaiting = false;
+	p->p_rclosed = p->p_wclosed = false;
+	p->p_nends = 2;
+	pollqueue_init(&p->p_rpollq);
+	pollqueue_init(&p->p_wpollq);
+
+	if (p->p_buf == NULL || p->p_rlock == NULL || p->p_wlock == NULL ||
+	    p->p_rwchan == NULL || p->p_wwchan == NULL) {
+		pipe_destroy(p);
+		return ENOMEM;
+	}
+
+	result = VOP_INIT(&p->p_rvnode, &pipe_vnode_ops, NULL, p);
+	if (result) {
+		pipe_destroy(p);
+		return result;
+	}
+	result = VOP_INIT(&p->p_wvnode, &pipe_vnode_ops, NULL, p);
+	if (result) {
+		VOP_CLEANUP(&p->p_rvnode);
+		pipe_destroy(p);
+		return result;
+	}
+
+	/* Hand them back open, as vfs_open would. */
+	VOP_INCOPEN(&p->p_rvnode);
+	VOP_INCOPEN(&p->p_wvnode);
+
+	*readend = &p->p_rvnode;
+	*writeend = &p->p_wvnode;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// waiting and waking
+
+/*
+ * Wake the reader if it is asleep, and anyone polling the read end.
+ *
+ * The waiting flag is looked at without p_lock first, so that waking
+ * nobody costs nothing. This is safe because of the in-order memory
+ * writes noted above: the reader sets p_rwaiting before it last looks
+ * at p_head, and we look at p_rwaiting after updating p_head, so if
+ * we miss the flag the reader sees our data and doesn't sleep.
+ */
+static
+void
+pipe_wakereader(struct pipe *p)
+{
+	if (p->p_rwaiting) {
+		spinlock_acquire(&p->p_lock);
+		if (p->p_rwaiting) {
+			p->p_rwaiting = false;
+			wchan_wakeall(p->p_rwchan);
+		}
+		spinlock_release(&p->p_lock);
+	}
+	pollqueue_wake(&p->p_rpollq);
+}
+
+/*
+ * Wake the writer if it is asleep, and anyone polling the write end.
+ * As above, with the roles reversed.
+ */
+static
+void
+pipe_wakewriter(struct pipe *p)
+{
+	if (p->p_wwaiting) {
+		spinlock_acquire(&p->p_lock);
+		if (p->p_wwaiting) {
+			p->p_wwaiting = false;
+			wchan_wakeall(p->p_wwchan);
+		}
+		spinlock_release(&p->p_lock);
+	}
+	pollqueue_wake(&p->p_wpollq);
+}
+
+/*
+ * Wait for the pipe to have room in it, or for the read end to be
+ * closed. Wakes the reader first, since emptying the pipe is up to
+ * it. May return early; the caller must check again.
+ */
+static
+void
+pipe_waitroom(struct pipe *p)
+{
+	pollqueue_wake(&p->p_rpollq);
+
+	spinlock_acquire(&p->p_lock);
+	if (p->p_rwaiting) {
+		p->p_rwaiting = false;
+		wchan_wakeall(p->p_rwchan);
+	}
+	if (p->p_head - p->p_tail == PIPE_SIZE && !p->p_rclosed) {
+		p->p_wwaiting = true;
+		wchan_lock(p->p_wwchan);
+		spinlock_release(&p->p_lock);
+		wchan_sleep(p->p_wwchan);
+		return;
+	}
+	spinlock_release(&p->p_lock);
+}
+
+/*
+ * Wait for data in the pipe. Wakes the writer first, since filling
+ * the pipe is up to it. Returns false if the pipe is empty and the
+ * write end is closed, that is, at end of file. May return early;
+ * the caller must check again.
+ */
+static
+bool
+pipe_waitdata(struct pipe *p)
+{
+	bool more;
+
+	pollqueue_wake(&p->p_wpollq);
+
+	more = true;
+	spinlock_acquire(&p->p_lock);
+	if (p->p_wwaiting) {
+		p->p_wwaiting = false;
+		wchan_wakeall(p->p_wwchan);
+	}
+	if (p->p_head == p->p_tail) {
+		if (p->p_wclosed) {
+			more = false;
+		}
+		else {
+			p->p_rwaiting = true;
+			wchan_lock(p->p_rwchan);
+			spinlock_release(&p->p_lock);
+			wchan_sleep(p->p_rwchan);
+			return true;
+		}
+	}
+	spinlock_release(&p->p_lock);
+	return more;
+}
+
+////////////////////////////////////////////////////////////
+// vnode operations
+
+/*
+ * Called on the last close of one end. Wake up whoever is waiting
+ * at the other end so they notice.
+ */
+static
+int
+pipe_close(struct vnode *v)
+{
+	struct pipe *p = v->vn_data;
+
+	spinlock_acquire(&p->p_lock);
+	if (v == &p->p_wvnode) {
+		p->p_wclosed = true;
+		if (p->p_rwaiting) {
+			p->p_rwaiting = false;
+			wchan_wakeall(p->p_rwchan);
+		}
+	}
+	else {
+		p->p_rclosed = true;
+		if (p->p_wwaiting) {
+			p->p_wwaiting = false;
+			wchan_wakeall(p->p_wwchan);
+		}
+	}
+	spinlock_release(&p->p_lock);
+
+	if (v == &p->p_wvnode) {
+		pollqueue_wake(&p->p_rpollq);
+	}
+	else {
+		pollqueue_wake(&p->p_wpollq);
+	}
+	return 0;
+}
+
+/*
+ * Called when the last reference to one end goes away. The pipe goes
+ * away with the second end.
+ */
+static
+int
+pipe_reclaim(struct vnode *v)
+{
+	struct pipe *p = v->vn_data;
+	bool last;
+
+	VOP_CLEANUP(v);
+
+	spinlock_acquire(&p->p_lock);
+	KASSERT(p->p_nends > 0);
+	p->p_nends--;
+	last = p->p_nends == 0;
+	spinlock_release(&p->p_lock);
+
+	if (last) {
+		pipe_destroy(p);
+	}
+	return 0;
+}
+
+/*
+ * Read whatever is in the pipe, up to the size of the request,
+ * waiting only if it is empty.
+ */
+static
+int
+pipe_read(struct vnode *v, struct uio *uio)
+{
+	struct pipe *p = v->vn_data;
+	size_t orig, len;
+	unsigned tail;
+	int result;
+
+	KASSERT(uio->uio_rw == UIO_READ);
+	if (v != &p->p_rvnode) {
+		return EBADF;
+	}
+
+	orig = uio->uio_resid;
+	result = 0;
+
+	lock_acquire(p->p_rlock);
+	while (uio->uio_resid > 0) {
+		tail = p->p_tail;
+		len = p->p_head - tail;
+		if (len == 0) {
+			if (uio->uio_resid < orig || !pipe_waitdata(p)) {
+				break;
+			}
+			continue;
+		}
+
+		/* Copy out as much as is contiguous in the buffer. */
+		if (len > PIPE_SIZE - (tail & PIPE_MASK)) {
+			len = PIPE_SIZE - (tail & PIPE_MASK);
+		}
+		if (len > uio->uio_resid) {
+			len = uio->uio_resid;
+		}
+		result = uiomove(p->p_buf + (tail & PIPE_MASK), len, uio);
+		if (result) {
+			break;
+		}
+		p->p_tail = tail + len;
+
+		if (p->p_wwaiting &&
+		    PIPE_SIZE - (p->p_head - p->p_tail) >= PIPE_WAKEMARK) {
+			pipe_wakewriter(p);
+		}
+	}
+	if (uio->uio_resid < orig) {
+		pipe_wakewriter(p);
+	}
+	lock_release(p->p_rlock);
+
+	return result;
+}
+
+/*
+ * Write everything, waiting for room as needed.
+ */
+static
+int
+pipe_write(struct vnode *v, struct uio *uio)
+{
+	struct pipe *p = v->vn_data;
+	size_t orig, len;
+	unsigned head;
+	int result;
+
+	KASSERT(uio->uio_rw == UIO_WRITE);
+	if (v != &p->p_wvnode) {
+		return EBADF;
+	}
+
+	orig = uio->uio_resid;
+	result = 0;
+
+	lock_acquire(p->p_wlock);
+	while (uio->uio_resid > 0) {
+		if (p->p_rclosed) {
+			result = EPIPE;
+			break;
+		}
+		head = p->p_head;
+		len = PIPE_SIZE - (head - p->p_tail);
+		if (len == 0) {
+			pipe_waitroom(p);
+			continue;
+		}
+
+		/* Copy in as much as fits contiguously in the buffer. */
+		if (len > PIPE_SIZE - (head & PIPE_MASK)) {
+			len = PIPE_SIZE - (head & PIPE_MASK);
+		}
+		if (len > uio->uio_resid) {
+			len = uio->uio_resid;
+		}
+		result = uiomove(p->p_buf + (head & PIPE_MASK), len, uio);
+		if (result) {
+			break;
+		}
+		p->p_head = head + len;
+
+		if (p->p_rwaiting && p->p_head - p->p_tail >= PIPE_WAKEMARK) {
+			pipe_wakereader(p);
+		}
+	}
+	if (uio->uio_resid < orig) {
+		pipe_wakereader(p);
+	}
+	lock_release(p->p_wlock);
+
+	return result;
+}
+
+/*
+ * The read end is readable when there is data or the write end is
+ * closed (read returns EOF at once), and then also hung up. The write
+ * end is writeable when there is room, and in error when the read
+ * end is closed (write fails at once with EPIPE).
+ */
+static
+int
+pipe_poll(struct vnode *v, int events, int *revents, struct pollwait *pw)
+{
+	struct pipe *p = v->vn_data;
+	int ready;
+
+	ready = 0;
+	if (v == &p->p_rvnode) {
+		pollwait_register(pw, &p->p_rpollq);
+		if (p->p_wclosed) {
+			ready = POLLIN | POLLHUP;
+		}
+		else if (p->p_head != p->p_tail) {
+			ready = POLLIN;
+		}
+	}
+	else {
+		pollwait_register(pw, &p->p_wpollq);
+		if (p->p_rclosed) {
+			ready = POLLOUT | POLLERR;
+		}
+		else if (p->p_head - p->p_tail < PIPE_SIZE) {
+			ready = POLLOUT;
+		}
+	}
+
+	/* POLLHUP and POLLERR are reported whether asked for or not. */
+	*revents = ready & (events | POLLHUP | POLLERR);
+	return 0;
+}
+
+static
+int
+pipe_stat(struct vnode *v, struct stat *statbuf)
+{
+	struct pipe *p = v->vn_data;
+
+	bzero(statbuf, sizeof(struct stat));
+	statbuf->st_mode = S_IFIFO | 0600;
+	statbuf->st_size = p->p_head - p->p_tail;
+	statbuf->st_blksize = PIPE_SIZE;
+	statbuf->st_nlink = 1;
+	return 0;
+}
+
+static
+int
+pipe_gettype(struct vnode *v, mode_t *ret)
+{
+	(void)v;
+	*ret = S_IFIFO;
+	return 0;
+}
+
+/*
+ * Pipes are only opened by pipe_create, never by name.
+ */
+static
+int
+pipe_open(struct vnode *v, int flags)
+{
+	(void)v;
+	(void)flags;
+	return EINVAL;
+}
+
+/*
+ * The rest are not meaningful on pipes. pipe_io is used for several
+ * functions with the same type signature.
+ */
+static
+int
+pipe_io(struct vnode *v, struct uio *uio)
+{
+	(void)v;
+	(void)uio;
+	return EINVAL;
+}
+
+static
+int
+pipe_ioctl(struct vnode *v, int op, userptr_t data)
+{
+	(void)v;
+	(void)op;
+	(void)data;
+	return EIOCTL;
+}
+
+static
+int
+pipe_tryseek(struct vnode *v, off_t pos)
+{
+	(void)v;
+	(void)pos;
+	return ESPIPE;
+}
+
+static
+int
+pipe_fsync(struct vnode *v)
+{
+	(void)v;
+	return 0;
+}
+
+static
+int
+pipe_mmap(struct vnode *v)
+{
+	(void)v;
+	return ENODEV;
+}
+
+static
+int
+pipe_truncate(struct vnode *v, off_t len)
+{
+	(void)v;
+	(void)len;
+	return EINVAL;
+}
+
+static
+int
+pipe_creat(struct vnode *v, const char *name, bool excl, mode_t mode,
+	   struct vnode **result)
+{
+	(void)v;
+	(void)name;
+	(void)excl;
+	(void)mode;
+	(void)result;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_symlink(struct vnode *v, const char *contents, const char *name)
+{
+	(void)v;
+	(void)contents;
+	(void)name;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_mkdir(struct vnode *v, const char *name, mode_t mode)
+{
+	(void)v;
+	(void)name;
+	(void)mode;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_link(struct vnode *v, const char *name, struct vnode *file)
+{
+	(void)v;
+	(void)name;
+	(void)file;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_nameop(struct vnode *v, const char *name)
+{
+	(void)v;
+	(void)name;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_rename(struct vnode *v, const char *n1, struct vnode *v2,
+	    const char *n2)
+{
+	(void)v;
+	(void)n1;
+	(void)v2;
+	(void)n2;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_lookup(struct vnode *v, char *pathname, struct vnode **result)
+{
+	(void)v;
+	(void)pathname;
+	(void)result;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_lookparent(struct vnode *v, char *pathname, struct vnode **result,
+		char *namebuf, size_t buflen)
+{
+	(void)v;
+	(void)pathname;
+	(void)result;
+	(void)namebuf;
+	(void)buflen;
+	return ENOTDIR;
+}
+
+/*
+ * Function table for pipe vnodes.
+ */
+static const struct vnode_ops pipe_vnode_ops = {
+	VOP_MAGIC,
+
+	pipe_open,
+	pipe_close,
+	pipe_reclaim,
+	pipe_read,
+	pipe_io,      /* readlink */
+	pipe_io,      /* getdirentry */
+	pipe_write,
+	pipe_ioctl,
+	pipe_poll,
+	pipe_stat,
+	pipe_gettype,
+	pipe_tryseek,
+	pipe_fsync,
+	pipe_mmap,
+	pipe_truncate,
+	pipe_io,      /* namefile */
+	pipe_creat,
+	pipe_symlink,
+	pipe_mkdir,
+	pipe_link,
+	pipe_nameop,  /* remove */
+	pipe_nameop,  /* rmdir */
+	pipe_rename,
+	pipe_lookup,
+	pipe_lookparent,
+};
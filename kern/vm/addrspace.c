@@ -27,10 +27,21 @@
  * SUCH DAMAGE.
  */
 
+#define ADDRSPACEINLINE
+
 #include <types.h>
 #include <kern/errno.h>
+#include <kern/mman.h>
+#include <kern/stat.h>
 #include <lib.h>
+#include <spinlock.h>
+#include <thread.h>
+#include <current.h>
+#include <uio.h>
+#include <vnode.h>
 #include <addrspace.h>
+#include <pagetable.h>
+#include <pagecache.h>
 #include <vm.h>
 
 /*
@@ -39,6 +50,178 @@
  * used. The cheesy hack versions in dumbvm.c are used instead.
  */
 
+/* Stack size limit for new address spaces, in pages */
+static size_t as_stacklimit = VM_STACKPAGES;
+
+/* Fault-around window for new regions, in pages */
+static unsigned as_faultaround = VM_FAULTAROUND;
+
+/* TLB and fault counters of address spaces that have been destroyed */
+static struct spinlock as_statlock = SPINLOCK_INITIALIZER;
+static unsigned as_totmisses;
+static unsigned as_totrefills;
+static unsigned as_totfaults;
+static unsigned as_totprefills;
+
+/*
+ * Create a region covering NPAGES pages starting at BASE.
+ */
+static
+struct region *
+region_create(vaddr_t base, size_t npages,
+	      bool readable, bool writeable, bool executable)
+{
+	struct region *reg;
+
+	reg = kmalloc(sizeof(*reg));
+	if (reg == NULL) {
+		return NULL;
+	}
+	reg->rg_base = base;
+	reg->rg_npages = npages;
+	reg->rg_readable = readable;
+	reg->rg_writeable = writeable;
+	reg->rg_executable = executable;
+	reg->rg_vnode = NULL;
+	reg->rg_fileoffset = 0;
+	reg->rg_filevaddr = 0;
+	reg->rg_filesize = 0;
+	reg->rg_pcfile = NULL;
+	reg->rg_mapped = false;
+	reg->rg_shared = false;
+	reg->rg_maxwrite = true;
+	reg->rg_faultaround = as_faultaround;
+	return reg;
+}
+
+/*
+ * Destroy a region, dropping its reference to the backing file.
+ */
+static
+void
+region_destroy(struct region *reg)
+{
+	if (reg->rg_pcfile != NULL) {
+		pagecache_detach(reg->rg_pcfile);
+	}
+	if (reg->rg_vnode != NULL) {
+		VOP_DECREF(reg->rg_vnode);
+	}
+	kfree(reg);
+}
+
+/*
+ * Make REG backed by FILESIZE bytes of file V starting at OFFSET,
+ * appearing at FILEVADDR. If SHARE is set, the region's pages come
+ * from the page cache. Returns ENOMEM if the page cache can't take
+ * the file; the region is then left without a file.
+ */
+static
+int
+region_setfile(struct region *reg, struct vnode *v, off_t offset,
+	       vaddr_t filevaddr, size_t filesize, bool share)
+{
+	KASSERT(reg->rg_vnode == NULL);
+
+	if (share) {
+		reg->rg_pcfile = pagecache_attach(v);
+		if (reg->rg_pcfile == NULL) {
+			return ENOMEM;
+		}
+	}
+	VOP_INCREF(v);
+	reg->rg_vnode = v;
+	reg->rg_fileoffset = offset;
+	reg->rg_filevaddr = filevaddr;
+	reg->rg_filesize = filesize;
+	return 0;
+}
+
+/*
+ * Give the new region TO the same backing and mmap attributes as
+ * FROM. Used when copying and splitting regions.
+ */
+static
+int
+region_copyattrs(struct region *to, const struct region *from)
+{
+	to->rg_mapped = from->rg_mapped;
+	to->rg_shared = from->rg_shared;
+	to->rg_maxwrite = from->rg_maxwrite;
+	to->rg_faultaround = from->rg_faultaround;
+	if (from->rg_vnode == NULL) {
+		return 0;
+	}
+	return region_setfile(to, from->rg_vnode, from->rg_fileoffset,
+			      from->rg_filevaddr, from->rg_filesize,
+			      from->rg_pcfile != NULL);
+}
+
+/*
+ * Check if the range [BASE, TOP) overlaps any region other than
+ * EXCEPT (which may be NULL).
+ */
+static
+bool
+as_overlaps(struct addrspace *as, vaddr_t base, vaddr_t top,
+	    struct region *except)
+{
+	struct region *reg;
+	vaddr_t regtop;
+	unsigned i, num;
+
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		if (reg == except) {
+			continue;
+		}
+		regtop = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+		if (base < regtop && reg->rg_base < top) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Add a region to an address space, checking that it neither leaves
+ * user space nor overlaps any existing region. Hands back the new
+ * region if RET is not NULL.
+ */
+static
+int
+as_addregion(struct addrspace *as, vaddr_t base, size_t npages,
+	     bool readable, bool writeable, bool executable,
+	     struct region **ret)
+{
+	struct region *reg;
+	vaddr_t top;
+	int result;
+
+	top = base + npages * PAGE_SIZE;
+	if (top < base || top > USERSPACETOP) {
+		return EFAULT;
+	}
+	if (as_overlaps(as, base, top, NULL)) {
+		return EINVAL;
+	}
+
+	reg = region_create(base, npages, readable, writeable, executable);
+	if (reg == NULL) {
+		return ENOMEM;
+	}
+	result = regionarray_add(&as->as_regions, reg, NULL);
+	if (result) {
+		region_destroy(reg);
+		return result;
+	}
+	if (ret != NULL) {
+		*ret = reg;
+	}
+	return 0;
+}
+
 struct addrspace *
 as_create(void)
 {
@@ -49,9 +232,23 @@ as_create(void)
 		return NULL;
 	}
 
-	/*
-	 * Initialize as needed.
-	 */
+	regionarray_init(&as->as_regions);
+	as->as_pt = pt_create();
+	if (as->as_pt == NULL) {
+		regionarray_cleanup(&as->as_regions);
+		kfree(as);
+		return NULL;
+	}
+	as->as_loading = false;
+	as->as_heap = NULL;
+	as->as_heapend = 0;
+	as->as_stack = NULL;
+	as->as_stackpages = as_stacklimit;
+	mmu_asinit(as);
+	as->as_ntlbmisses = 0;
+	as->as_ntlbrefills = 0;
+	as->as_nfaults = 0;
+	as->as_nprefills = 0;
 
 	return as;
 }
@@ -60,18 +257,52 @@ int
 as_copy(struct addrspace *old, struct addrspace **ret)
 {
 	struct addrspace *newas;
+	struct region *reg, *newreg;
+	unsigned i, num;
+	int result;
 
 	newas = as_create();
 	if (newas==NULL) {
 		return ENOMEM;
 	}
 
+	num = regionarray_num(&old->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&old->as_regions, i);
+		result = as_addregion(newas, reg->rg_base, reg->rg_npages,
+				      reg->rg_readable, reg->rg_writeable,
+				      reg->rg_executable, &newreg);
+		if (result) {
+			as_destroy(newas);
+			return result;
+		}
+		result = region_copyattrs(newreg, reg);
+		if (result) {
+			as_destroy(newas);
+			return result;
+		}
+		if (reg == old->as_heap) {
+			newas->as_heap = newreg;
+		}
+		if (reg == old->as_stack) {
+			newas->as_stack = newreg;
+		}
+	}
+	newas->as_heapend = old->as_heapend;
+	newas->as_stackpages = old->as_stackpages;
+
 	/*
-	 * Write this.
+	 * Share all the pages copy-on-write. Translations for OLD
+	 * may be in the MMU with write permission; revoke them so the
+	 * next write to a shared page faults.
 	 */
+	result = pt_copy(old->as_pt, newas->as_pt);
+	mmu_revoke(old);
+	if (result) {
+		as_destroy(newas);
+		return result;
+	}
 
-	(void)old;
-	
 	*ret = newas;
 	return 0;
 }
@@ -79,21 +310,36 @@ as_copy(struct addrspace *old, struct addrspace **ret)
 void
 as_destroy(struct addrspace *as)
 {
-	/*
-	 * Clean up as needed.
-	 */
-	
+	unsigned i, num;
+
+	DEBUG(DB_VM, "vm: address space %u: %u TLB misses, %u refilled "
+	      "from cache, %u faults, %u pages faulted around\n",
+	      as->as_mmu.ma_id, as->as_ntlbmisses, as->as_ntlbrefills,
+	      as->as_nfaults, as->as_nprefills);
+
+	spinlock_acquire(&as_statlock);
+	as_totmisses += as->as_ntlbmisses;
+	as_totrefills += as->as_ntlbrefills;
+	as_totfaults += as->as_nfaults;
+	as_totprefills += as->as_nprefills;
+	spinlock_release(&as_statlock);
+
+	pt_destroy(as->as_pt);
+
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		region_destroy(regionarray_get(&as->as_regions, i));
+	}
+	regionarray_setsize(&as->as_regions, 0);
+	regionarray_cleanup(&as->as_regions);
+
 	kfree(as);
 }
 
 void
 as_activate(struct addrspace *as)
 {
-	/*
-	 * Write this.
-	 */
-
-	(void)as;  // suppress warning until code gets written
+	mmu_activate(as);
 }
 
 /*
@@ -102,61 +348,759 @@ as_activate(struct addrspace *as)
  * VADDR+MEMSIZE.
  *
  * The READABLE, WRITEABLE, and EXECUTABLE flags are set if read,
- * write, or execute permission should be set on the segment. At the
- * moment, these are ignored. When you write the VM system, you may
- * want to implement them.
+ * write, or execute permission should be set on the segment.
+ * Writes to a segment without WRITEABLE set fault (except while the
+ * executable is being loaded); the other two are recorded but not
+ * enforced, since the MIPS MMU cannot enforce them.
+ *
+ * No memory is allocated; pages are zero-filled on first touch.
  */
+static
+int
+as_defineregion(struct addrspace *as, vaddr_t vaddr, size_t sz,
+		int readable, int writeable, int executable,
+		struct region **ret)
+{
+	size_t npages;
+
+	/* Align the region. First, the base... */
+	sz += vaddr & ~(vaddr_t)PAGE_FRAME;
+	vaddr &= PAGE_FRAME;
+
+	/* ...and now the length. */
+	sz = (sz + PAGE_SIZE - 1) & PAGE_FRAME;
+
+	npages = sz / PAGE_SIZE;
+	if (npages == 0) {
+		*ret = NULL;
+		return 0;
+	}
+
+	return as_addregion(as, vaddr, npages,
+			    readable != 0, writeable != 0, executable != 0,
+			    ret);
+}
+
 int
 as_define_region(struct addrspace *as, vaddr_t vaddr, size_t sz,
 		 int readable, int writeable, int executable)
 {
+	struct region *reg;
+
+	return as_defineregion(as, vaddr, sz,
+			       readable, writeable, executable, &reg);
+}
+
+/*
+ * Set up a segment whose first FILESIZE bytes are the contents of
+ * file V starting at OFFSET. Nothing is read now; each page is read
+ * from the file when it is first touched (see as_loadpage), so
+ * starting a big program costs no more than starting a small one.
+ * The rest of the segment, if any, is zero-filled.
+ *
+ * The region holds a reference to V for as long as it exists. If the
+ * segment is read-only, its pages are shared with every other process
+ * running the same program through the page cache.
+ */
+int
+as_define_segment(struct addrspace *as, vaddr_t vaddr, size_t memsize,
+		  struct vnode *v, off_t offset, size_t filesize,
+		  int readable, int writeable, int executable)
+{
+	struct region *reg;
+	int result;
+
+	KASSERT(filesize <= memsize);
+
+	result = as_defineregion(as, vaddr, memsize,
+				 readable, writeable, executable, &reg);
+	if (result) {
+		return result;
+	}
+	if (reg == NULL || filesize == 0) {
+		/* Nothing to read. */
+		return 0;
+	}
+
 	/*
-	 * Write this.
+	 * Only share if file pages line up with memory pages, which
+	 * they always do in a sane executable.
 	 */
+	result = region_setfile(reg, v, offset, vaddr, filesize,
+				!writeable &&
+				((off_t)vaddr - offset) % PAGE_SIZE == 0);
+	if (result) {
+		/* Fall back to a private copy. */
+		result = region_setfile(reg, v, offset, vaddr, filesize,
+					false);
+		KASSERT(result == 0);
+	}
+	return 0;
+}
 
-	(void)as;
-	(void)vaddr;
-	(void)sz;
-	(void)readable;
-	(void)writeable;
-	(void)executable;
-	return EUNIMP;
+/*
+ * Find the region containing VADDR.
+ */
+struct region *
+as_findregion(struct addrspace *as, vaddr_t vaddr)
+{
+	struct region *reg;
+	unsigned i, num;
+
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		if (vaddr >= reg->rg_base &&
+		    vaddr < reg->rg_base + reg->rg_npages * PAGE_SIZE) {
+			return reg;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Fill in the page at VADDR of file-backed region REG, whose physical
+ * page PADDR has already been zeroed, with whatever part of the
+ * file image falls in it. The caller holds the page's lpage lock.
+ */
+int
+as_loadpage(struct region *reg, vaddr_t vaddr, paddr_t paddr)
+{
+	struct iovec iov;
+	struct uio ku;
+	vaddr_t start, end, fileend;
+	int result;
+
+	KASSERT((vaddr & PAGE_FRAME) == vaddr);
+	KASSERT((paddr & PAGE_FRAME) == paddr);
+
+	if (reg->rg_vnode == NULL) {
+		return 0;
+	}
+
+	/* Intersect the page with the file image. */
+	fileend = reg->rg_filevaddr + reg->rg_filesize;
+	start = vaddr > reg->rg_filevaddr ? vaddr : reg->rg_filevaddr;
+	end = vaddr + PAGE_SIZE < fileend ? vaddr + PAGE_SIZE : fileend;
+	if (start >= end) {
+		/* All bss. */
+		return 0;
+	}
+
+	DEBUG(DB_VM, "vm: loading 0x%x from file offset %llu\n", start,
+	      (unsigned long long)(reg->rg_fileoffset +
+				   (start - reg->rg_filevaddr)));
+
+	uio_kinit(&iov, &ku,
+		  (void *)(PADDR_TO_KVADDR(paddr) + (start - vaddr)),
+		  end - start,
+		  reg->rg_fileoffset + (start - reg->rg_filevaddr),
+		  UIO_READ);
+	result = VOP_READ(reg->rg_vnode, &ku);
+	if (result) {
+		return result;
+	}
+	if (ku.uio_resid != 0) {
+		/* The file was truncated after the program started. */
+		return EIO;
+	}
+	return 0;
 }
 
 int
 as_prepare_load(struct addrspace *as)
 {
 	/*
-	 * Write this.
+	 * Let the kernel write into read-only segments while loading.
+	 * Nothing needs to be allocated; segments are read in from
+	 * the executable as they fault in.
 	 */
-
-	(void)as;
+	as->as_loading = true;
 	return 0;
 }
 
 int
 as_complete_load(struct addrspace *as)
 {
+	struct region *reg;
+	vaddr_t top, regtop;
+	unsigned i, num;
+	int result;
+
+	as->as_loading = false;
+
+	/* The heap starts out empty, just above the highest segment. */
+	top = 0;
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		regtop = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+		if (regtop > top) {
+			top = regtop;
+		}
+	}
+	result = as_addregion(as, top, 0, true, true, false, &as->as_heap);
+	if (result) {
+		return result;
+	}
+	as->as_heapend = top;
+
 	/*
-	 * Write this.
+	 * Drop the writeable translations loading left behind for
+	 * read-only segments.
 	 */
-
-	(void)as;
+	mmu_revoke(as);
 	return 0;
 }
 
+/*
+ * The stack starts out one page long; as_growstack extends it as
+ * it's used.
+ */
 int
 as_define_stack(struct addrspace *as, vaddr_t *stackptr)
 {
-	/*
-	 * Write this.
-	 */
+	int result;
 
-	(void)as;
+	result = as_addregion(as, USERSTACK - PAGE_SIZE, 1,
+			      true, true, false, &as->as_stack);
+	if (result) {
+		return result;
+	}
 
 	/* Initial user-level stack pointer */
 	*stackptr = USERSTACK;
-	
+
+	return 0;
+}
+
+/*
+ * Lowest address reserved for the stack: its limit, less one guard
+ * page that is never mapped so that running off the end of the stack
+ * faults instead of landing in another region.
+ */
+static
+vaddr_t
+as_stackfloor(struct addrspace *as)
+{
+	return USERSTACK - (as->as_stackpages + 1) * PAGE_SIZE;
+}
+
+struct region *
+as_growstack(struct addrspace *as, vaddr_t vaddr)
+{
+	struct region *stack;
+
+	stack = as->as_stack;
+	if (stack == NULL) {
+		return NULL;
+	}
+
+	vaddr &= PAGE_FRAME;
+	if (vaddr >= stack->rg_base || vaddr <= as_stackfloor(as)) {
+		return NULL;
+	}
+
+	/* Keep the page below the new bottom free, as a guard. */
+	if (as_overlaps(as, vaddr - PAGE_SIZE, stack->rg_base, stack)) {
+		return NULL;
+	}
+
+	DEBUG(DB_VM, "vm: stack grows to 0x%x\n", vaddr);
+	stack->rg_npages += (stack->rg_base - vaddr) / PAGE_SIZE;
+	stack->rg_base = vaddr;
+	return stack;
+}
+
+int
+as_setstacklimit(size_t npages)
+{
+	if (npages == 0 || npages >= USERSTACK / PAGE_SIZE / 2) {
+		return EINVAL;
+	}
+	as_stacklimit = npages;
+	return 0;
+}
+
+int
+as_setfaultaround(unsigned npages)
+{
+	if (npages == 0 || npages > VM_FAULTAROUNDMAX ||
+	    (npages & (npages - 1)) != 0) {
+		return EINVAL;
+	}
+	as_faultaround = npages;
+	return 0;
+}
+
+/*
+ * Move the end of the heap by AMOUNT bytes, and hand back the old
+ * end. Pages added to the heap are zero-filled when first touched,
+ * like the rest of user memory; pages removed from it are released
+ * right away.
+ */
+int
+as_sbrk(struct addrspace *as, intptr_t amount, vaddr_t *oldend)
+{
+	struct region *heap;
+	vaddr_t newend, top;
+	size_t npages;
+
+	heap = as->as_heap;
+	if (heap == NULL) {
+		/* Not a loaded program. */
+		return EINVAL;
+	}
+
+	/* Negate in unsigned arithmetic; -INTPTR_MIN would overflow. */
+	if (amount < 0 &&
+	    (vaddr_t)0 - (vaddr_t)amount > as->as_heapend - heap->rg_base) {
+		return EINVAL;
+	}
+	if (amount > 0 && (vaddr_t)amount > USERSPACETOP - as->as_heapend) {
+		return ENOMEM;
+	}
+	newend = as->as_heapend + amount;
+
+	npages = DIVROUNDUP(newend - heap->rg_base, PAGE_SIZE);
+	top = heap->rg_base + npages * PAGE_SIZE;
+
+	if (npages > heap->rg_npages) {
+		if (top > as_stackfloor(as) ||
+		    as_overlaps(as, heap->rg_base, top, heap)) {
+			return ENOMEM;
+		}
+		heap->rg_npages = npages;
+	}
+	else if (npages < heap->rg_npages) {
+		/* Drop translations before the pages can be reused. */
+		mmu_revoke(as);
+		pt_clear(as->as_pt, top,
+			 heap->rg_base + heap->rg_npages * PAGE_SIZE);
+		heap->rg_npages = npages;
+	}
+
+	*oldend = as->as_heapend;
+	as->as_heapend = newend;
+	return 0;
+}
+
+/*
+ * Remove REG from the address space and destroy it. The caller takes
+ * care of its pages.
+ */
+static
+void
+as_removeregion(struct addrspace *as, struct region *reg)
+{
+	unsigned i, num;
+
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		if (regionarray_get(&as->as_regions, i) == reg) {
+			regionarray_remove(&as->as_regions, i);
+			region_destroy(reg);
+			return;
+		}
+	}
+	panic("as_removeregion: region not found\n");
+}
+
+/*
+ * If a region straddles VADDR, split it in two there, so that VADDR
+ * is a region boundary.
+ */
+static
+int
+as_splitat(struct addrspace *as, vaddr_t vaddr)
+{
+	struct region *reg, *newreg;
+	size_t npages;
+	int result;
+
+	KASSERT((vaddr & PAGE_FRAME) == vaddr);
+
+	reg = as_findregion(as, vaddr);
+	if (reg == NULL || reg->rg_base == vaddr) {
+		return 0;
+	}
+	KASSERT(reg != as->as_heap);
+
+	npages = (vaddr - reg->rg_base) / PAGE_SIZE;
+	newreg = region_create(vaddr, reg->rg_npages - npages,
+			       reg->rg_readable, reg->rg_writeable,
+			       reg->rg_executable);
+	if (newreg == NULL) {
+		return ENOMEM;
+	}
+	result = region_copyattrs(newreg, reg);
+	if (result) {
+		region_destroy(newreg);
+		return result;
+	}
+	result = regionarray_add(&as->as_regions, newreg, NULL);
+	if (result) {
+		region_destroy(newreg);
+		return result;
+	}
+	reg->rg_npages = npages;
+	return 0;
+}
+
+/*
+ * Find room for a mapping of NPAGES pages: the highest free range
+ * between the top of the heap and the space reserved for the stack.
+ */
+static
+int
+as_findspace(struct addrspace *as, size_t npages, vaddr_t *ret)
+{
+	struct region *reg;
+	vaddr_t base, top, newtop, bottom, regtop;
+	size_t size;
+	unsigned i, num;
+
+	size = npages * PAGE_SIZE;
+	bottom = PAGE_SIZE;
+	if (as->as_heap != NULL) {
+		bottom = as->as_heap->rg_base +
+			as->as_heap->rg_npages * PAGE_SIZE;
+	}
+	top = as_stackfloor(as);
+
+	while (top >= bottom && top - bottom >= size) {
+		base = top - size;
+		newtop = top;
+		num = regionarray_num(&as->as_regions);
+		for (i=0; i<num; i++) {
+			reg = regionarray_get(&as->as_regions, i);
+			regtop = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+			if (base < regtop && reg->rg_base < top &&
+			    reg->rg_base < newtop) {
+				newtop = reg->rg_base;
+			}
+		}
+		if (newtop == top) {
+			*ret = base;
+			return 0;
+		}
+		top = newtop;
+	}
+	return ENOMEM;
+}
+
+/*
+ * Check the range for munmap, mprotect, and madvise, and round its end up to a
+ * page boundary.
+ */
+static
+int
+as_checkrange(vaddr_t addr, size_t len, vaddr_t *top)
+{
+	if ((addr & PAGE_FRAME) != addr || len == 0) {
+		return EINVAL;
+	}
+	if (addr >= USERSPACETOP || len > USERSPACETOP - addr) {
+		return EINVAL;
+	}
+	*top = addr + DIVROUNDUP(len, PAGE_SIZE) * PAGE_SIZE;
+	return 0;
+}
+
+/*
+ * Map a file (or anonymous zero-filled memory). The file is read a
+ * page at a time as the mapping is touched, like program segments.
+ * Shared mappings and read-only private ones take their pages from
+ * the page cache; writeable private ones read private copies. Pages
+ * past the end of the file read as zeros and are never written back.
+ */
+int
+as_mmap(struct addrspace *as, vaddr_t addr, size_t len, int prot, int flags,
+	struct vnode *v, off_t offset, bool canwrite, vaddr_t *ret)
+{
+	struct region *reg;
+	struct stat st;
+	size_t npages, filesize;
+	bool shared;
+	int result;
+
+	/* Exactly one of MAP_SHARED and MAP_PRIVATE. */
+	shared = (flags & MAP_SHARED) != 0;
+	if (shared == ((flags & MAP_PRIVATE) != 0)) {
+		return EINVAL;
+	}
+	if ((prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) != 0) {
+		return EINVAL;
+	}
+	if (len == 0 || offset < 0 || offset % PAGE_SIZE != 0) {
+		return EINVAL;
+	}
+	if (len > USERSPACETOP) {
+		return ENOMEM;
+	}
+	if (shared && v != NULL && !canwrite && (prot & PROT_WRITE)) {
+		return EACCES;
+	}
+	npages = DIVROUNDUP(len, PAGE_SIZE);
+
+	filesize = 0;
+	if (v == NULL) {
+		/* Anonymous memory can't be shared (except by fork). */
+		if (shared) {
+			return EINVAL;
+		}
+	}
+	else {
+		result = VOP_MMAP(v);
+		if (result) {
+			return result;
+		}
+		result = VOP_STAT(v, &st);
+		if (result) {
+			return result;
+		}
+		if (st.st_size > offset) {
+			filesize = npages * PAGE_SIZE;
+			if (st.st_size - offset < (off_t)filesize) {
+				filesize = st.st_size - offset;
+			}
+		}
+	}
+
+	if (flags & MAP_FIXED) {
+		if ((addr & PAGE_FRAME) != addr) {
+			return EINVAL;
+		}
+	}
+	else {
+		result = as_findspace(as, npages, &addr);
+		if (result) {
+			return result;
+		}
+	}
+
+	result = as_addregion(as, addr, npages, (prot & PROT_READ) != 0,
+			      (prot & PROT_WRITE) != 0,
+			      (prot & PROT_EXEC) != 0, &reg);
+	if (result) {
+		return result == EFAULT ? ENOMEM : result;
+	}
+	reg->rg_mapped = true;
+	reg->rg_shared = shared;
+	reg->rg_maxwrite = !shared || v == NULL || canwrite;
+
+	if (v != NULL) {
+		result = region_setfile(reg, v, offset, addr, filesize,
+					shared || (prot & PROT_WRITE) == 0);
+		if (result) {
+			as_removeregion(as, reg);
+			return result;
+		}
+	}
+
+	DEBUG(DB_VM, "vm: mapped %u pages at 0x%x\n", npages, addr);
+	*ret = addr;
+	return 0;
+}
+
+int
+as_munmap(struct addrspace *as, vaddr_t addr, size_t len)
+{
+	struct region *reg;
+	vaddr_t top, regtop;
+	unsigned i, num;
+	int result;
+
+	result = as_checkrange(addr, len, &top);
+	if (result) {
+		return result;
+	}
+
+	/* Only mappings can be unmapped; unmapped holes are fine. */
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		regtop = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+		if (addr < regtop && reg->rg_base < top && !reg->rg_mapped) {
+			return EINVAL;
+		}
+	}
+
+	result = as_splitat(as, addr);
+	if (result) {
+		return result;
+	}
+	result = as_splitat(as, top);
+	if (result) {
+		return result;
+	}
+
+	/*
+	 * Write back shared mappings first, and leave everything
+	 * mapped if that fails, so the changes aren't thrown away
+	 * without the caller knowing.
+	 */
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		if (reg->rg_base >= addr && reg->rg_base < top &&
+		    reg->rg_shared) {
+			result = pagecache_sync(reg->rg_pcfile);
+			if (result) {
+				return result;
+			}
+		}
+	}
+
+	mmu_revoke(as);
+	pt_clear(as->as_pt, addr, top);
+
+	i = 0;
+	while (i < regionarray_num(&as->as_regions)) {
+		reg = regionarray_get(&as->as_regions, i);
+		if (reg->rg_base < addr || reg->rg_base >= top) {
+			i++;
+			continue;
+		}
+		regionarray_remove(&as->as_regions, i);
+		region_destroy(reg);
+	}
 	return 0;
 }
 
+int
+as_mprotect(struct addrspace *as, vaddr_t addr, size_t len, int prot)
+{
+	struct region *reg;
+	vaddr_t top, va;
+	unsigned i, num;
+	int result;
+
+	if ((prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) != 0) {
+		return EINVAL;
+	}
+	result = as_checkrange(addr, len, &top);
+	if (result) {
+		return result;
+	}
+
+	/* Every page must be mapped, and by mmap. */
+	va = addr;
+	while (va < top) {
+		reg = as_findregion(as, va);
+		if (reg == NULL) {
+			return ENOMEM;
+		}
+		if (!reg->rg_mapped) {
+			return EINVAL;
+		}
+		if ((prot & PROT_WRITE) && !reg->rg_maxwrite) {
+			return EACCES;
+		}
+		va = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+	}
+
+	result = as_splitat(as, addr);
+	if (result) {
+		return result;
+	}
+	result = as_splitat(as, top);
+	if (result) {
+		return result;
+	}
+
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		if (reg->rg_base >= addr && reg->rg_base < top) {
+			reg->rg_readable = (prot & PROT_READ) != 0;
+			reg->rg_writeable = (prot & PROT_WRITE) != 0;
+			reg->rg_executable = (prot & PROT_EXEC) != 0;
+		}
+	}
+
+	/* Drop translations that allow more than the new permissions. */
+	mmu_revoke(as);
+	return 0;
+}
+
+/*
+ * Set the fault-around window of mappings. MADV_NORMAL goes back to
+ * the default for new regions.
+ */
+int
+as_madvise(struct addrspace *as, vaddr_t addr, size_t len, int advice)
+{
+	struct region *reg;
+	vaddr_t top, va;
+	unsigned i, num, window;
+	int result;
+
+	switch (advice) {
+	    case MADV_NORMAL:
+		window = as_faultaround;
+		break;
+	    case MADV_RANDOM:
+		window = 1;
+		break;
+	    case MADV_SEQUENTIAL:
+		window = VM_FAULTAROUNDMAX;
+		break;
+	    default:
+		return EINVAL;
+	}
+	result = as_checkrange(addr, len, &top);
+	if (result) {
+		return result;
+	}
+
+	/* Every page must be mapped, and by mmap. */
+	va = addr;
+	while (va < top) {
+		reg = as_findregion(as, va);
+		if (reg == NULL) {
+			return ENOMEM;
+		}
+		if (!reg->rg_mapped) {
+			return EINVAL;
+		}
+		va = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+	}
+
+	result = as_splitat(as, addr);
+	if (result) {
+		return result;
+	}
+	result = as_splitat(as, top);
+	if (result) {
+		return result;
+	}
+
+	num = regionarray_num(&as->as_regions);
+	for (i=0; i<num; i++) {
+		reg = regionarray_get(&as->as_regions, i);
+		if (reg->rg_base >= addr && reg->rg_base < top) {
+			reg->rg_faultaround = window;
+		}
+	}
+	return 0;
+}
+
+void
+as_printstats(void)
+{
+	unsigned misses, refills, faults, prefills;
+
+	/* kprintf may sleep, so copy the counters out first. */
+	spinlock_acquire(&as_statlock);
+	misses = as_totmisses;
+	refills = as_totrefills;
+	faults = as_totfaults;
+	prefills = as_totprefills;
+	spinlock_release(&as_statlock);
+
+	kprintf("vm: exited processes: %u TLB misses, %u refilled from "
+		"cache\n", misses, refills);
+	kprintf("vm: exited processes: %u faults, %u pages faulted "
+		"around\n", faults, prefills);
+}
@@ -0,0 +1,828 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <thread.h>
+#include <cpu.h>
+#include <current.h>
+#include <lpage.h>
+#include <swap.h>
+#include <coremap.h>
+#include <vm.h>
+
+/*
+ * Physical page allocator.
+ *
+ * When no page is free, a user page is chosen by the current
+ * eviction policy, written out to swap, and handed to the caller.
+ *
+ * Free pages are kept on two lists: ones with unknown contents, and
+ * ones known to be zero-filled. Idle cpus move pages from the first
+ * list to the second (coremap_prezero), so zero-fill faults usually
+ * get a page that is already clear. Other allocations take pages
+ * from the first list when they can, to leave the zeroed ones.
+ */
+
+/* Page states */
+#define CM_FREE		0	/* on the free list */
+#define CM_KERNEL	1	/* kernel page (alloc_kpages) */
+#define CM_USER		2	/* user page (page_alloc) */
+#define CM_NSTATES	3
+
+/* Null link */
+#define CM_NONE		((uint32_t)-1)
+
+/* Maximum number of pages to evict at once */
+#define COREMAP_EVICTBATCH	8
+
+/* Pre-zeroed pool: at most 1/COREMAP_ZERODIV of memory, zeroed in
+   batches of up to COREMAP_ZEROBATCH pages each time a cpu idles */
+#define COREMAP_ZERODIV		16
+#define COREMAP_ZEROBATCH	4
+
+struct coremap_entry {
+	uint32_t cm_next;		/* free list links (indexes) */
+	uint32_t cm_prev;
+	uint32_t cm_npages;		/* length of kernel run starting here */
+	unsigned cm_state;		/* CM_FREE etc. */
+	struct lpage *cm_lpage;		/* owner of user page, or NULL */
+	bool cm_busy;			/* being evicted or zeroed */
+	bool cm_zeroed;			/* free and known to be zero */
+	bool cm_referenced;		/* used since the clock hand passed */
+	uint32_t cm_cpumask;		/* cpus that may have it mapped */
+};
+
+static struct coremap_entry *coremap;
+static unsigned coremap_npages;	/* number of entries */
+static paddr_t coremap_base;	/* physical address of entry 0 */
+
+static uint32_t coremap_freehead;	/* head of free list */
+static uint32_t coremap_zerohead;	/* head of zeroed free list */
+static unsigned coremap_count[CM_NSTATES];
+static unsigned coremap_nevictions;
+
+static unsigned coremap_nzeroed;	/* pages on zeroed list */
+static unsigned coremap_zerotarget;	/* how many we'd like there */
+static unsigned coremap_nzerohits;	/* zero-fills served from it */
+static unsigned coremap_nzeromisses;	/* zero-fills that had to bzero */
+
+/*
+ * coremap_lock protects everything above. stealmem_lock protects
+ * ram_stealmem before the coremap exists.
+ */
+static struct spinlock coremap_lock = SPINLOCK_INITIALIZER;
+static struct spinlock stealmem_lock = SPINLOCK_INITIALIZER;
+
+static const char *const coremap_statenames[CM_NSTATES] = {
+	"free",
+	"kernel",
+	"user",
+};
+
+#define COREMAP_INDEX(pa)	(((pa) - coremap_base) / PAGE_SIZE)
+#define COREMAP_PADDR(ix)	(coremap_base + (paddr_t)(ix) * PAGE_SIZE)
+
+////////////////////////////////////////////////////////////
+// free list
+
+/*
+ * Put a free page on the free list, or the zeroed free list if
+ * cm_zeroed is set.
+ */
+static
+void
+freelist_insert(uint32_t ix)
+{
+	struct coremap_entry *e = &coremap[ix];
+	uint32_t *head;
+
+	KASSERT(spinlock_do_i_hold(&coremap_lock));
+
+	head = e->cm_zeroed ? &coremap_zerohead : &coremap_freehead;
+	e->cm_prev = CM_NONE;
+	e->cm_next = *head;
+	if (*head != CM_NONE) {
+		coremap[*head].cm_prev = ix;
+	}
+	*head = ix;
+	if (e->cm_zeroed) {
+		coremap_nzeroed++;
+	}
+}
+
+/*
+ * Take a page off whichever free list it's on. Clears cm_zeroed.
+ */
+static
+void
+freelist_remove(uint32_t ix)
+{
+	struct coremap_entry *e = &coremap[ix];
+	uint32_t *head;
+
+	KASSERT(spinlock_do_i_hold(&coremap_lock));
+
+	head = e->cm_zeroed ? &coremap_zerohead : &coremap_freehead;
+	if (e->cm_prev != CM_NONE) {
+		coremap[e->cm_prev].cm_next = e->cm_next;
+	}
+	else {
+		KASSERT(*head == ix);
+		*head = e->cm_next;
+	}
+	if (e->cm_next != CM_NONE) {
+		coremap[e->cm_next].cm_prev = e->cm_prev;
+	}
+	e->cm_next = e->cm_prev = CM_NONE;
+	if (e->cm_zeroed) {
+		KASSERT(coremap_nzeroed > 0);
+		coremap_nzeroed--;
+		e->cm_zeroed = false;
+	}
+}
+
+/*
+ * Change the state of a page, keeping the counters and free list
+ * consistent.
+ */
+static
+void
+coremap_setstate(uint32_t ix, unsigned state)
+{
+	struct coremap_entry *e = &coremap[ix];
+
+	KASSERT(e->cm_state != state);
+
+	if (e->cm_state == CM_FREE) {
+		freelist_remove(ix);
+	}
+	coremap_count[e->cm_state]--;
+	e->cm_state = state;
+	coremap_count[state]++;
+	if (state == CM_FREE) {
+		freelist_insert(ix);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// setup
+
+void
+coremap_bootstrap(void)
+{
+	paddr_t lo, hi;
+	unsigned npages, cmpages, i;
+	paddr_t cmpaddr;
+
+	/*
+	 * Figure out how many pages the coremap itself needs and
+	 * steal them, then take the rest of memory from ram.c.
+	 */
+	ram_getsize(&lo, &hi);
+	KASSERT(lo != 0 && hi > lo);
+	npages = (hi - lo) / PAGE_SIZE;
+	cmpages = DIVROUNDUP(npages * sizeof(struct coremap_entry), PAGE_SIZE);
+	KASSERT(cmpages < npages);
+
+	cmpaddr = lo;
+	lo += cmpages * PAGE_SIZE;
+
+	spinlock_acquire(&coremap_lock);
+
+	coremap = (struct coremap_entry *)PADDR_TO_KVADDR(cmpaddr);
+	coremap_base = lo;
+	coremap_npages = npages - cmpages;
+	coremap_freehead = CM_NONE;
+	coremap_zerohead = CM_NONE;
+	coremap_zerotarget = coremap_npages / COREMAP_ZERODIV;
+	coremap_count[CM_FREE] = coremap_npages;
+	coremap_count[CM_KERNEL] = 0;
+	coremap_count[CM_USER] = 0;
+
+	/* Build the free list so the lowest pages come off first. */
+	for (i=coremap_npages; i-- > 0; ) {
+		coremap[i].cm_npages = 0;
+		coremap[i].cm_state = CM_FREE;
+		coremap[i].cm_lpage = NULL;
+		coremap[i].cm_busy = false;
+		coremap[i].cm_zeroed = false;
+		coremap[i].cm_referenced = false;
+		coremap[i].cm_cpumask = 0;
+		freelist_insert(i);
+	}
+
+	spinlock_release(&coremap_lock);
+
+	kprintf("coremap: %u pages (%u used by coremap)\n",
+		coremap_npages, cmpages);
+}
+
+////////////////////////////////////////////////////////////
+// eviction policies
+
+/*
+ * An eviction policy picks a user page to evict. ep_choose is called
+ * with the coremap locked, and returns the index of the victim, with
+ * its lpage locked via lpage_trylock, or CM_NONE if it finds nothing
+ * suitable. To add a policy, write a choose function and add it to
+ * coremap_policies.
+ */
+struct evictpolicy {
+	const char *ep_name;
+	uint32_t (*ep_choose)(void);
+};
+
+/*
+ * Check if a page can be evicted, and if so lock its lpage.
+ */
+static
+bool
+coremap_trylock(uint32_t ix)
+{
+	struct coremap_entry *e = &coremap[ix];
+
+	KASSERT(spinlock_do_i_hold(&coremap_lock));
+
+	if (e->cm_state != CM_USER || e->cm_busy || e->cm_lpage == NULL) {
+		return false;
+	}
+	return lpage_trylock(e->cm_lpage);
+}
+
+/*
+ * Clock (second chance): sweep a hand around memory, skipping and
+ * clearing pages that have been used since it last passed.
+ */
+static uint32_t clock_hand;
+
+static
+uint32_t
+clock_choose(void)
+{
+	uint32_t ix;
+	unsigned i;
+
+	/* Two passes: the first may only clear reference bits. */
+	for (i=0; i<2*coremap_npages; i++) {
+		ix = clock_hand;
+		clock_hand = (clock_hand + 1) % coremap_npages;
+
+		if (coremap[ix].cm_state != CM_USER) {
+			continue;
+		}
+		if (coremap[ix].cm_referenced) {
+			coremap[ix].cm_referenced = false;
+			continue;
+		}
+		if (coremap_trylock(ix)) {
+			return ix;
+		}
+	}
+	return CM_NONE;
+}
+
+/*
+ * Random: start at a random page and take the first evictable one.
+ */
+static
+uint32_t
+random_choose(void)
+{
+	uint32_t start, ix;
+	unsigned i;
+
+	start = random() % coremap_npages;
+	for (i=0; i<coremap_npages; i++) {
+		ix = (start + i) % coremap_npages;
+		if (coremap_trylock(ix)) {
+			return ix;
+		}
+	}
+	return CM_NONE;
+}
+
+static const struct evictpolicy coremap_policies[] = {
+	{ "clock",	clock_choose },
+	{ "random",	random_choose },
+	{ NULL, NULL },
+};
+
+/* Current policy; protected by coremap_lock. */
+static const struct evictpolicy *coremap_policy = &coremap_policies[0];
+
+int
+coremap_setpolicy(const char *name)
+{
+	unsigned i;
+
+	for (i=0; coremap_policies[i].ep_name != NULL; i++) {
+		if (!strcmp(coremap_policies[i].ep_name, name)) {
+			spinlock_acquire(&coremap_lock);
+			coremap_policy = &coremap_policies[i];
+			spinlock_release(&coremap_lock);
+			return 0;
+		}
+	}
+	return EINVAL;
+}
+
+/*
+ * Note that a user page has been mapped into this cpu's MMU. This
+ * marks it used, for the clock policy (the MIPS MMU has no reference
+ * bits), and records the cpu so eviction knows where to send TLB
+ * shootdowns. Called by mmu_map at splhigh, with the page's lpage
+ * locked, so eviction can't be clearing the cpu mask at the same time.
+ */
+void
+coremap_touch(paddr_t paddr)
+{
+	uint32_t ix;
+
+	ix = COREMAP_INDEX(paddr);
+	KASSERT(ix < coremap_npages);
+	coremap[ix].cm_referenced = true;
+	if (curcpu->c_number < 32) {
+		coremap[ix].cm_cpumask |= (uint32_t)1 << curcpu->c_number;
+	}
+	else {
+		coremap[ix].cm_cpumask = (uint32_t)-1;
+	}
+}
+
+/*
+ * Note that a user page has been used again through a translation
+ * this cpu already had (in its software TLB), so the clock policy
+ * doesn't take it for idle. The cpu mask is already right. Called at
+ * splhigh, so a shootdown of the page can't come in meanwhile; a race
+ * with the clock hand clearing the bit only costs a second chance.
+ */
+void
+coremap_reference(paddr_t paddr)
+{
+	uint32_t ix;
+
+	ix = COREMAP_INDEX(paddr);
+	KASSERT(ix < coremap_npages);
+	coremap[ix].cm_referenced = true;
+}
+
+/*
+ * Remove all translations for a user page, on whatever cpus may have
+ * it mapped, without evicting it. Used when a page is written back
+ * to its file, so the next write to it is noticed.
+ */
+void
+coremap_shootdown(paddr_t paddr)
+{
+	uint32_t ix, cpumask;
+
+	ix = COREMAP_INDEX(paddr);
+	KASSERT(ix < coremap_npages);
+
+	spinlock_acquire(&coremap_lock);
+	KASSERT(coremap[ix].cm_state == CM_USER);
+	cpumask = coremap[ix].cm_cpumask;
+	spinlock_release(&coremap_lock);
+
+	mmu_shootdown(&paddr, 1, cpumask);
+}
+
+////////////////////////////////////////////////////////////
+// allocation
+
+/*
+ * Find a run of NPAGES free pages. A single page comes from the
+ * zeroed list if WANTZERO is set and from the other list otherwise,
+ * falling back to the other one. Returns the index of the first, or
+ * CM_NONE.
+ */
+static
+uint32_t
+coremap_findrun(unsigned npages, bool wantzero)
+{
+	uint32_t ix, base;
+	unsigned run;
+
+	KASSERT(spinlock_do_i_hold(&coremap_lock));
+
+	if (npages == 1 && wantzero) {
+		return coremap_zerohead != CM_NONE ?
+			coremap_zerohead : coremap_freehead;
+	}
+	if (npages == 1) {
+		return coremap_freehead != CM_NONE ?
+			coremap_freehead : coremap_zerohead;
+	}
+
+	run = 0;
+	base = 0;
+	for (ix=0; ix<coremap_npages; ix++) {
+		if (coremap[ix].cm_state != CM_FREE || coremap[ix].cm_busy) {
+			run = 0;
+			continue;
+		}
+		if (run == 0) {
+			base = ix;
+		}
+		run++;
+		if (run == npages) {
+			return base;
+		}
+	}
+	return CM_NONE;
+}
+
+/*
+ * Evict a batch of pages chosen by the policy, hand one to the caller
+ * (with the coremap still locked) as a page of the given state and
+ * owner, and put the rest on the free list. Returns CM_NONE if
+ * nothing could be evicted.
+ *
+ * Evicting several pages at once means the TLB shootdowns for all of
+ * them go out together, and the next few allocations don't have to
+ * wait for pageouts.
+ */
+static
+uint32_t
+coremap_evict(unsigned state, struct lpage *lp)
+{
+	uint32_t victims[COREMAP_EVICTBATCH];
+	struct lpage *lpages[COREMAP_EVICTBATCH];
+	paddr_t paddrs[COREMAP_EVICTBATCH];
+	int results[COREMAP_EVICTBATCH];
+	uint32_t ix, ret, cpumask;
+	unsigned i, n;
+
+	KASSERT(spinlock_do_i_hold(&coremap_lock));
+
+	cpumask = 0;
+	for (n=0; n<COREMAP_EVICTBATCH; n++) {
+		ix = coremap_policy->ep_choose();
+		if (ix == CM_NONE) {
+			break;
+		}
+		KASSERT(coremap[ix].cm_state == CM_USER);
+		coremap[ix].cm_busy = true;
+		cpumask |= coremap[ix].cm_cpumask;
+		victims[n] = ix;
+		lpages[n] = coremap[ix].cm_lpage;
+		paddrs[n] = COREMAP_PADDR(ix);
+	}
+	if (n == 0) {
+		return CM_NONE;
+	}
+
+	spinlock_release(&coremap_lock);
+
+	/* One round of shootdowns for the whole batch. */
+	mmu_shootdown(paddrs, n, cpumask);
+	for (i=0; i<n; i++) {
+		results[i] = lpage_evict(lpages[i]);
+	}
+
+	/*
+	 * Settle the coremap entries before unlocking the lpages. A page
+	 * that failed to go out still belongs to its lpage, which may be
+	 * waiting in lpage_decref to free it, and must not find it busy.
+	 */
+	spinlock_acquire(&coremap_lock);
+
+	/* Take the first page that made it out; free the rest. */
+	ret = CM_NONE;
+	for (i=0; i<n; i++) {
+		ix = victims[i];
+		if (results[i]) {
+			DEBUG(DB_VM, "coremap: eviction failed: %s\n",
+			      strerror(results[i]));
+			coremap[ix].cm_busy = false;
+			continue;
+		}
+
+		coremap_nevictions++;
+		coremap[ix].cm_cpumask = 0;
+		if (ret == CM_NONE) {
+			if (state != CM_USER) {
+				coremap_setstate(ix, state);
+			}
+			coremap[ix].cm_lpage = lp;
+			coremap[ix].cm_npages = 1;
+			coremap[ix].cm_referenced = true;
+			ret = ix;
+		}
+		else {
+			coremap[ix].cm_busy = false;
+			coremap[ix].cm_lpage = NULL;
+			coremap[ix].cm_npages = 0;
+			coremap_setstate(ix, CM_FREE);
+		}
+	}
+
+	/* Keep the page we're handing out busy while the coremap is open. */
+	spinlock_release(&coremap_lock);
+	for (i=0; i<n; i++) {
+		lpage_unlock(lpages[i]);
+	}
+	spinlock_acquire(&coremap_lock);
+
+	if (ret != CM_NONE) {
+		coremap[ret].cm_busy = false;
+	}
+	return ret;
+}
+
+/*
+ * Check if we can wait for pageout I/O, i.e., we aren't in an
+ * interrupt handler or holding spinlocks, and there is somewhere to
+ * page out to.
+ */
+static
+bool
+coremap_canevict(void)
+{
+	return swap_available() && curthread != NULL &&
+		!curthread->t_in_interrupt &&
+		curthread->t_iplhigh_count == 0;
+}
+
+/*
+ * Allocate NPAGES pages in the given state for owner LP. If ZERO is
+ * set (single pages only), the page is zero-filled, preferably by
+ * taking it from the zeroed list.
+ */
+static
+paddr_t
+coremap_alloc(unsigned npages, unsigned state, struct lpage *lp, bool zero)
+{
+	uint32_t base, ix;
+	bool canevict, waszeroed;
+
+	KASSERT(npages == 1 || !zero);
+
+	/* Only single pages are evicted for; runs would rarely work. */
+	canevict = npages == 1 && coremap_canevict();
+
+	spinlock_acquire(&coremap_lock);
+
+	base = coremap_findrun(npages, zero);
+	if (base == CM_NONE && canevict) {
+		base = coremap_evict(state, lp);
+		if (zero && base != CM_NONE) {
+			coremap_nzeromisses++;
+		}
+		spinlock_release(&coremap_lock);
+		if (base == CM_NONE) {
+			return 0;
+		}
+		if (zero) {
+			bzero((void *)PADDR_TO_KVADDR(COREMAP_PADDR(base)),
+			      PAGE_SIZE);
+		}
+		return COREMAP_PADDR(base);
+	}
+	if (base == CM_NONE) {
+		spinlock_release(&coremap_lock);
+		return 0;
+	}
+	waszeroed = coremap[base].cm_zeroed;
+	if (zero && waszeroed) {
+		coremap_nzerohits++;
+	}
+	else if (zero) {
+		coremap_nzeromisses++;
+	}
+	for (ix=base; ix<base+npages; ix++) {
+		coremap_setstate(ix, state);
+		coremap[ix].cm_referenced = true;
+		coremap[ix].cm_cpumask = 0;
+	}
+	coremap[base].cm_npages = npages;
+	coremap[base].cm_lpage = lp;
+
+	spinlock_release(&coremap_lock);
+
+	if (zero && !waszeroed) {
+		bzero((void *)PADDR_TO_KVADDR(COREMAP_PADDR(base)), PAGE_SIZE);
+	}
+	return COREMAP_PADDR(base);
+}
+
+static
+void
+coremap_free(paddr_t paddr, unsigned state)
+{
+	uint32_t base, ix;
+	unsigned npages;
+
+	KASSERT((paddr & PAGE_FRAME) == paddr);
+
+	spinlock_acquire(&coremap_lock);
+
+	base = COREMAP_INDEX(paddr);
+	KASSERT(base < coremap_npages);
+	KASSERT(coremap[base].cm_state == state);
+	KASSERT(!coremap[base].cm_busy);
+	npages = coremap[base].cm_npages;
+	KASSERT(npages > 0 && base + npages <= coremap_npages);
+
+	coremap[base].cm_npages = 0;
+	coremap[base].cm_lpage = NULL;
+	for (ix=base; ix<base+npages; ix++) {
+		KASSERT(coremap[ix].cm_state == state);
+		coremap_setstate(ix, CM_FREE);
+	}
+
+	spinlock_release(&coremap_lock);
+}
+
+/*
+ * Before the coremap exists, take pages with ram_stealmem.
+ */
+static
+paddr_t
+getppages(unsigned long npages)
+{
+	paddr_t addr;
+
+	spinlock_acquire(&stealmem_lock);
+	addr = ram_stealmem(npages);
+	spinlock_release(&stealmem_lock);
+
+	return addr;
+}
+
+/* Allocate/free some kernel-space virtual pages */
+vaddr_t
+alloc_kpages(int npages)
+{
+	paddr_t pa;
+
+	KASSERT(npages > 0);
+
+	if (coremap == NULL) {
+		pa = getppages(npages);
+	}
+	else {
+		pa = coremap_alloc(npages, CM_KERNEL, NULL, false);
+	}
+	if (pa == 0) {
+		return 0;
+	}
+	return PADDR_TO_KVADDR(pa);
+}
+
+void
+free_kpages(vaddr_t addr)
+{
+	paddr_t pa;
+
+	KASSERT(addr >= MIPS_KSEG0);
+	pa = addr - MIPS_KSEG0;
+
+	if (coremap == NULL || pa < coremap_base) {
+		/* Stolen before the coremap existed; can't be freed. */
+		return;
+	}
+	coremap_free(pa, CM_KERNEL);
+}
+
+/* Allocate/free a physical page for user memory */
+paddr_t
+page_alloc(struct lpage *lp)
+{
+	KASSERT(coremap != NULL);
+	return coremap_alloc(1, CM_USER, lp, false);
+}
+
+paddr_t
+page_alloczero(struct lpage *lp)
+{
+	KASSERT(coremap != NULL);
+	return coremap_alloc(1, CM_USER, lp, true);
+}
+
+void
+page_free(paddr_t paddr)
+{
+	coremap_free(paddr, CM_USER);
+}
+
+////////////////////////////////////////////////////////////
+// pre-zeroing
+
+/*
+ * Top up the zeroed free list by a few pages, if it's short. Called
+ * from the idle loop with interrupts off, so it must not sleep and
+ * shouldn't take long. The pages are marked busy and kept off both
+ * free lists while being zeroed, so nobody else can take them.
+ */
+void
+coremap_prezero(void)
+{
+	uint32_t batch[COREMAP_ZEROBATCH];
+	uint32_t ix;
+	unsigned i, n;
+
+	if (coremap == NULL) {
+		return;
+	}
+
+	spinlock_acquire(&coremap_lock);
+	n = 0;
+	while (n < COREMAP_ZEROBATCH &&
+	       coremap_nzeroed + n < coremap_zerotarget &&
+	       coremap_freehead != CM_NONE) {
+		ix = coremap_freehead;
+		freelist_remove(ix);
+		coremap[ix].cm_busy = true;
+		batch[n++] = ix;
+	}
+	spinlock_release(&coremap_lock);
+
+	if (n == 0) {
+		return;
+	}
+
+	for (i=0; i<n; i++) {
+		bzero((void *)PADDR_TO_KVADDR(COREMAP_PADDR(batch[i])),
+		      PAGE_SIZE);
+	}
+
+	spinlock_acquire(&coremap_lock);
+	for (i=0; i<n; i++) {
+		ix = batch[i];
+		KASSERT(coremap[ix].cm_state == CM_FREE);
+		coremap[ix].cm_busy = false;
+		coremap[ix].cm_zeroed = true;
+		freelist_insert(ix);
+	}
+	spinlock_release(&coremap_lock);
+}
+
+////////////////////////////////////////////////////////////
+// stats
+
+void
+coremap_printstats(void)
+{
+	unsigned counts[CM_NSTATES];
+	unsigned i, total, nevictions;
+	unsigned nzeroed, zerotarget, nzerohits, nzeromisses;
+
+	if (coremap == NULL) {
+		kprintf("coremap: not initialized\n");
+		return;
+	}
+
+	spinlock_acquire(&coremap_lock);
+	total = coremap_npages;
+	for (i=0; i<CM_NSTATES; i++) {
+		counts[i] = coremap_count[i];
+	}
+	nevictions = coremap_nevictions;
+	nzeroed = coremap_nzeroed;
+	zerotarget = coremap_zerotarget;
+	nzerohits = coremap_nzerohits;
+	nzeromisses = coremap_nzeromisses;
+	spinlock_release(&coremap_lock);
+
+	kprintf("coremap: %u pages:", total);
+	for (i=0; i<CM_NSTATES; i++) {
+		kprintf(" %u %s", counts[i], coremap_statenames[i]);
+	}
+	kprintf("\n");
+	kprintf("coremap: %u evictions (policy %s)\n", nevictions,
+		coremap_policy->ep_name);
+	kprintf("coremap: zero pool %u/%u pages, %u hits, %u misses "
+		"(%u%% hit rate)\n", nzeroed, zerotarget, nzerohits,
+		nzeromisses, nzerohits + nzeromisses == 0 ? 0 :
+		nzerohits * 100 / (nzerohits + nzeromisses));
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <uio.h>
+#include <vnode.h>
+#include <lpage.h>
+#include <coremap.h>
+#include <swap.h>
+#include <vm.h>
+
+/*
+ * Logical pages.
+ */
+
+/*
+ * Threads waiting for an lpage lock all sleep here. Contention is
+ * rare enough that one channel for all pages is fine.
+ */
+static struct wchan *lpage_wchan;
+
+void
+lpage_bootstrap(void)
+{
+	lpage_wchan = wchan_create("lpage");
+	if (lpage_wchan == NULL) {
+		panic("lpage_bootstrap: Out of memory\n");
+	}
+}
+
+////////////////////////////////////////////////////////////
+// locking
+
+void
+lpage_lock(struct lpage *lp)
+{
+	spinlock_acquire(&lp->lp_lock);
+	while (lp->lp_busy) {
+		/*
+		 * Lock the wchan before dropping lp_lock, so the
+		 * wakeup in lpage_unlock can't slip in between.
+		 */
+		wchan_lock(lpage_wchan);
+		spinlock_release(&lp->lp_lock);
+		wchan_sleep(lpage_wchan);
+		spinlock_acquire(&lp->lp_lock);
+	}
+	lp->lp_busy = true;
+	spinlock_release(&lp->lp_lock);
+}
+
+bool
+lpage_trylock(struct lpage *lp)
+{
+	bool ret;
+
+	spinlock_acquire(&lp->lp_lock);
+	ret = !lp->lp_busy;
+	lp->lp_busy = true;
+	spinlock_release(&lp->lp_lock);
+
+	return ret;
+}
+
+void
+lpage_unlock(struct lpage *lp)
+{
+	spinlock_acquire(&lp->lp_lock);
+	KASSERT(lp->lp_busy);
+	lp->lp_busy = false;
+	spinlock_release(&lp->lp_lock);
+
+	wchan_wakeall(lpage_wchan);
+}
+
+////////////////////////////////////////////////////////////
+// creation
+
+/*
+ * Allocate an lpage structure with no physical page behind it. It
+ * is returned locked.
+ */
+static
+struct lpage *
+lpage_create(void)
+{
+	struct lpage *lp;
+
+	lp = kmalloc(sizeof(*lp));
+	if (lp == NULL) {
+		return NULL;
+	}
+	spinlock_init(&lp->lp_lock);
+	lp->lp_refcount = 1;
+	lp->lp_busy = true;
+	lp->lp_dirty = false;
+	lp->lp_filedirty = false;
+	lp->lp_paddr = 0;
+	lp->lp_swapslot = SWAP_NOSLOT;
+	return lp;
+}
+
+/*
+ * Free an lpage structure. The physical page and swap slot must
+ * already be gone.
+ */
+static
+void
+lpage_free(struct lpage *lp)
+{
+	KASSERT(lp->lp_paddr == 0);
+	KASSERT(lp->lp_swapslot == SWAP_NOSLOT);
+
+	spinlock_cleanup(&lp->lp_lock);
+	kfree(lp);
+}
+
+/*
+ * Create a new lpage backed by a zero-filled physical page.
+ */
+int
+lpage_zerofill(struct lpage **lpret, paddr_t *paddrret)
+{
+	struct lpage *lp;
+	paddr_t pa;
+
+	lp = lpage_create();
+	if (lp == NULL) {
+		return ENOMEM;
+	}
+
+	pa = page_alloczero(lp);
+	if (pa == 0) {
+		lpage_free(lp);
+		return ENOMEM;
+	}
+	lp->lp_paddr = pa;
+	lp->lp_dirty = true;
+
+	*lpret = lp;
+	*paddrret = pa;
+	return 0;
+}
+
+/*
+ * Create a new lpage with the same contents as OLD.
+ */
+int
+lpage_copy(struct lpage *old, struct lpage **lpret, paddr_t *paddrret)
+{
+	struct lpage *lp;
+	paddr_t pa;
+
+	KASSERT(old->lp_busy);
+	KASSERT(old->lp_paddr != 0);
+
+	lp = lpage_create();
+	if (lp == NULL) {
+		return ENOMEM;
+	}
+
+	pa = page_alloc(lp);
+	if (pa == 0) {
+		lpage_free(lp);
+		return ENOMEM;
+	}
+	memmove((void *)PADDR_TO_KVADDR(pa),
+		(const void *)PADDR_TO_KVADDR(old->lp_paddr),
+		PAGE_SIZE);
+	lp->lp_paddr = pa;
+	lp->lp_dirty = true;
+
+	*lpret = lp;
+	*paddrret = pa;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// paging
+
+int
+lpage_pagein(struct lpage *lp, paddr_t *paddrret)
+{
+	paddr_t pa;
+	int result;
+
+	KASSERT(lp->lp_busy);
+
+	if (lp->lp_paddr != 0) {
+		*paddrret = lp->lp_paddr;
+		return 0;
+	}
+
+	KASSERT(lp->lp_swapslot != SWAP_NOSLOT);
+
+	pa = page_alloc(lp);
+	if (pa == 0) {
+		return ENOMEM;
+	}
+	result = swap_pagein(pa, lp->lp_swapslot);
+	if (result) {
+		page_free(pa);
+		return result;
+	}
+
+	/* Keep the slot; while the page stays clean it needn't be rewritten. */
+	lp->lp_paddr = pa;
+	lp->lp_dirty = false;
+
+	*paddrret = pa;
+	return 0;
+}
+
+int
+lpage_evict(struct lpage *lp)
+{
+	paddr_t pa;
+	bool newslot;
+	int result;
+
+	KASSERT(lp->lp_busy);
+	KASSERT(lp->lp_paddr != 0);
+
+	pa = lp->lp_paddr;
+
+	newslot = false;
+	if (lp->lp_swapslot == SWAP_NOSLOT) {
+		result = swap_alloc(&lp->lp_swapslot);
+		if (result) {
+			return result;
+		}
+		newslot = true;
+	}
+
+	if (lp->lp_dirty || newslot) {
+		result = swap_pageout(pa, lp->lp_swapslot);
+		if (result) {
+			if (newslot) {
+				swap_free(lp->lp_swapslot);
+				lp->lp_swapslot = SWAP_NOSLOT;
+			}
+			return result;
+		}
+	}
+
+	DEBUG(DB_VM, "lpage: evicted 0x%x to slot %u\n", pa,
+	      lp->lp_swapslot);
+
+	lp->lp_paddr = 0;
+	lp->lp_dirty = false;
+	return 0;
+}
+
+void
+lpage_markdirty(struct lpage *lp)
+{
+	KASSERT(lp->lp_busy);
+	KASSERT(lp->lp_paddr != 0);
+
+	lp->lp_dirty = true;
+	lp->lp_filedirty = true;
+}
+
+int
+lpage_writeback(struct lpage *lp, struct vnode *v, off_t offset,
+		unsigned lo, unsigned hi)
+{
+	struct iovec iov;
+	struct uio ku;
+	paddr_t pa;
+	int result;
+
+	KASSERT(lp->lp_busy);
+	KASSERT(lo <= hi && hi <= PAGE_SIZE);
+
+	if (!lp->lp_filedirty) {
+		return 0;
+	}
+
+	result = lpage_pagein(lp, &pa);
+	if (result) {
+		return result;
+	}
+
+	/* Make the next write fault so we notice it. */
+	coremap_shootdown(pa);
+	lp->lp_filedirty = false;
+
+	if (hi == lo) {
+		/* Entirely past EOF; nothing to write. */
+		return 0;
+	}
+
+	uio_kinit(&iov, &ku, (void *)(PADDR_TO_KVADDR(pa) + lo), hi - lo,
+		  offset + lo, UIO_WRITE);
+	result = VOP_WRITE(v, &ku);
+	if (result) {
+		lp->lp_filedirty = true;
+		return result;
+	}
+
+	DEBUG(DB_VM, "lpage: wrote back 0x%x to file offset %llu\n", pa,
+	      (unsigned long long)(offset + lo));
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// sharing
+
+/*
+ * Share an lpage with another page table.
+ */
+void
+lpage_incref(struct lpage *lp)
+{
+	spinlock_acquire(&lp->lp_lock);
+	KASSERT(lp->lp_refcount > 0);
+	lp->lp_refcount++;
+	spinlock_release(&lp->lp_lock);
+}
+
+/*
+ * Drop a reference to an lpage. When the last reference goes away,
+ * release the lpage along with its physical page and swap slot.
+ */
+void
+lpage_decref(struct lpage *lp)
+{
+	unsigned refcount;
+
+	spinlock_acquire(&lp->lp_lock);
+	KASSERT(lp->lp_refcount > 0);
+	refcount = --lp->lp_refcount;
+	spinlock_release(&lp->lp_lock);
+
+	if (refcount > 0) {
+		return;
+	}
+
+	/*
+	 * Nobody else can find the page now except the pageout code
+	 * through the coremap; wait for it to finish with the page.
+	 */
+	lpage_lock(lp);
+
+	if (lp->lp_paddr != 0) {
+		page_free(lp->lp_paddr);
+		lp->lp_paddr = 0;
+	}
+	if (lp->lp_swapslot != SWAP_NOSLOT) {
+		swap_free(lp->lp_swapslot);
+		lp->lp_swapslot = SWAP_NOSLOT;
+	}
+	lpage_free(lp);
+}
+
+/*
+ * Check if an lpage is shared (and thus copy-on-write).
+ *
+ * The answer can only go from true to false behind the caller's
+ * back, because references are only added by copying the caller's
+ * own page table, or by the page cache handing out a page it already
+ * holds a reference to. A stale "true" just costs an extra fault.
+ */
+bool
+lpage_isshared(struct lpage *lp)
+{
+	bool ret;
+
+	spinlock_acquire(&lp->lp_lock);
+	KASSERT(lp->lp_refcount > 0);
+	ret = lp->lp_refcount > 1;
+	spinlock_release(&lp->lp_lock);
+
+	return ret;
+}
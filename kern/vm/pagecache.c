@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <array.h>
+#include <spinlock.h>
+#include <synch.h>
+#include <vnode.h>
+#include <addrspace.h>
+#include <lpage.h>
+#include <pagecache.h>
+#include <vm.h>
+
+/*
+ * Page cache for read-only file-backed regions.
+ *
+ * There is one pcfile per cached vnode, found by linear search of
+ * pagecache_files; there are only ever as many as there are distinct
+ * programs running. Its pages are kept in an array indexed by file
+ * page number, with NULL for pages not (yet) cached.
+ *
+ * pagecache_lock protects pagecache_files and pf_users. Each pcfile's
+ * pf_lock protects its pages, and is held while a missing page is
+ * read from the file so that two processes faulting on the same page
+ * don't both read it, and during writeback. Lock order is
+ * pagecache_lock, then pf_lock, then the lpage lock.
+ *
+ * Shared mappings are not kept coherent with read and write on the
+ * same file; changes reach the file at munmap, at sync, or when the
+ * last mapping goes away.
+ */
+
+struct pcpage {
+	struct lpage *pp_lpage;		/* the page (cache holds a ref) */
+	unsigned pp_lo, pp_hi;		/* bytes that came from the file */
+};
+
+struct pcfile {
+	struct vnode *pf_vnode;		/* file (cache holds a ref) */
+	unsigned pf_users;		/* number of attached regions */
+	struct lock *pf_lock;		/* protects pf_pages */
+	struct array pf_pages;		/* struct pcpage by page number */
+};
+
+static struct lock *pagecache_lock;
+static struct array pagecache_files;
+
+static struct spinlock pagecache_statslock = SPINLOCK_INITIALIZER;
+static unsigned pagecache_npages;
+static unsigned pagecache_nhits;
+static unsigned pagecache_nmisses;
+static unsigned pagecache_npeeks;
+static unsigned pagecache_nwritebacks;
+
+void
+pagecache_bootstrap(void)
+{
+	pagecache_lock = lock_create("pagecache");
+	if (pagecache_lock == NULL) {
+		panic("pagecache: lock_create failed\n");
+	}
+	array_init(&pagecache_files);
+}
+
+struct pcfile *
+pagecache_attach(struct vnode *v)
+{
+	struct pcfile *pf;
+	unsigned i, num;
+	int result;
+
+	lock_acquire(pagecache_lock);
+
+	num = array_num(&pagecache_files);
+	for (i=0; i<num; i++) {
+		pf = array_get(&pagecache_files, i);
+		if (pf->pf_vnode == v) {
+			pf->pf_users++;
+			lock_release(pagecache_lock);
+			return pf;
+		}
+	}
+
+	pf = kmalloc(sizeof(*pf));
+	if (pf == NULL) {
+		lock_release(pagecache_lock);
+		return NULL;
+	}
+	pf->pf_lock = lock_create("pcfile");
+	if (pf->pf_lock == NULL) {
+		kfree(pf);
+		lock_release(pagecache_lock);
+		return NULL;
+	}
+	array_init(&pf->pf_pages);
+	pf->pf_users = 1;
+
+	result = array_add(&pagecache_files, pf, NULL);
+	if (result) {
+		array_cleanup(&pf->pf_pages);
+		lock_destroy(pf->pf_lock);
+		kfree(pf);
+		lock_release(pagecache_lock);
+		return NULL;
+	}
+	VOP_INCREF(v);
+	pf->pf_vnode = v;
+
+	lock_release(pagecache_lock);
+	return pf;
+}
+
+void
+pagecache_detach(struct pcfile *pf)
+{
+	struct pcpage *pp;
+	unsigned i, num, npages;
+	int result;
+
+	lock_acquire(pagecache_lock);
+	KASSERT(pf->pf_users > 0);
+	pf->pf_users--;
+	if (pf->pf_users > 0) {
+		lock_release(pagecache_lock);
+		return;
+	}
+
+	num = array_num(&pagecache_files);
+	for (i=0; i<num; i++) {
+		if (array_get(&pagecache_files, i) == pf) {
+			array_remove(&pagecache_files, i);
+			break;
+		}
+	}
+	KASSERT(i < num);
+	lock_release(pagecache_lock);
+
+	/* Nobody else can see PF now. */
+	result = pagecache_sync(pf);
+	if (result) {
+		kprintf("pagecache: writeback failed: %s\n",
+			strerror(result));
+	}
+
+	npages = 0;
+	num = array_num(&pf->pf_pages);
+	for (i=0; i<num; i++) {
+		pp = array_get(&pf->pf_pages, i);
+		if (pp != NULL) {
+			lpage_decref(pp->pp_lpage);
+			kfree(pp);
+			npages++;
+		}
+	}
+	array_setsize(&pf->pf_pages, 0);
+	array_cleanup(&pf->pf_pages);
+	lock_destroy(pf->pf_lock);
+	VOP_DECREF(pf->pf_vnode);
+	kfree(pf);
+
+	spinlock_acquire(&pagecache_statslock);
+	pagecache_npages -= npages;
+	spinlock_release(&pagecache_statslock);
+}
+
+/*
+ * Add a locked lpage to the cache as page INDEX of PF. Returns ENOMEM
+ * if it can't, in which case the page isn't cached.
+ */
+static
+int
+pagecache_insert(struct pcfile *pf, unsigned index, struct lpage *lp,
+		 unsigned lo, unsigned hi)
+{
+	struct pcpage *pp;
+	unsigned i, num;
+
+	KASSERT(lock_do_i_hold(pf->pf_lock));
+
+	num = array_num(&pf->pf_pages);
+	if (index >= num) {
+		if (array_setsize(&pf->pf_pages, index + 1)) {
+			return ENOMEM;
+		}
+		for (i=num; i<=index; i++) {
+			array_set(&pf->pf_pages, i, NULL);
+		}
+	}
+	KASSERT(array_get(&pf->pf_pages, index) == NULL);
+
+	pp = kmalloc(sizeof(*pp));
+	if (pp == NULL) {
+		return ENOMEM;
+	}
+	pp->pp_lpage = lp;
+	pp->pp_lo = lo;
+	pp->pp_hi = hi;
+	lpage_incref(lp);
+	array_set(&pf->pf_pages, index, pp);
+
+	spinlock_acquire(&pagecache_statslock);
+	pagecache_npages++;
+	spinlock_release(&pagecache_statslock);
+	return 0;
+}
+
+/*
+ * Make cached page PP, page INDEX of PF, cover the file bytes up to
+ * HI, for a shared mapping made after the file grew. Any changes are
+ * written back first, and then the page is read in again as REG sees
+ * it, picking up the new bytes. The page contents can't change while
+ * we do this: writes through other mappings fault once the page is
+ * clean, and wait for the lpage lock. Call with pf_lock held.
+ */
+static
+int
+pagecache_widen(struct pcfile *pf, struct pcpage *pp, unsigned index,
+		struct region *reg, vaddr_t vaddr, unsigned hi)
+{
+	struct lpage *lp;
+	paddr_t pa;
+	int result;
+
+	KASSERT(lock_do_i_hold(pf->pf_lock));
+	KASSERT(hi > pp->pp_hi);
+
+	lp = pp->pp_lpage;
+	lpage_lock(lp);
+	result = lpage_writeback(lp, pf->pf_vnode, (off_t)index * PAGE_SIZE,
+				 pp->pp_lo, pp->pp_hi);
+	if (result == 0) {
+		result = lpage_pagein(lp, &pa);
+	}
+	if (result == 0) {
+		result = as_loadpage(reg, vaddr, pa);
+	}
+	lpage_unlock(lp);
+	if (result) {
+		return result;
+	}
+	pp->pp_hi = hi;
+	return 0;
+}
+
+/*
+ * Find the file page number of the page at VADDR of file-backed
+ * region REG, and which part of the page comes from the file.
+ * Another segment may map the same file page with a different part
+ * of it zeroed; such pages aren't shared.
+ */
+static
+void
+pagecache_locate(struct region *reg, vaddr_t vaddr,
+		 unsigned *index, unsigned *lo, unsigned *hi)
+{
+	vaddr_t fileend;
+	off_t offset;
+
+	KASSERT((vaddr & PAGE_FRAME) == vaddr);
+
+	fileend = reg->rg_filevaddr + reg->rg_filesize;
+	*lo = vaddr < reg->rg_filevaddr ? reg->rg_filevaddr - vaddr : 0;
+	*hi = fileend < vaddr + PAGE_SIZE ? fileend - vaddr : PAGE_SIZE;
+	if (fileend <= vaddr || *hi <= *lo) {
+		*lo = *hi = 0;
+	}
+
+	/* as_define_segment only attaches regions where this is exact. */
+	offset = reg->rg_fileoffset + ((off_t)vaddr - reg->rg_filevaddr);
+	KASSERT(offset >= 0 && offset % PAGE_SIZE == 0);
+	*index = offset / PAGE_SIZE;
+}
+
+int
+pagecache_getpage(struct pcfile *pf, struct region *reg, vaddr_t vaddr,
+		  struct lpage **lpret, paddr_t *paddrret)
+{
+	struct pcpage *pp;
+	struct lpage *lp;
+	paddr_t pa;
+	unsigned index, lo, hi;
+	int result;
+
+	KASSERT(reg->rg_vnode == pf->pf_vnode);
+
+	pagecache_locate(reg, vaddr, &index, &lo, &hi);
+
+	lock_acquire(pf->pf_lock);
+
+	pp = NULL;
+	if (index < array_num(&pf->pf_pages)) {
+		pp = array_get(&pf->pf_pages, index);
+	}
+
+	/*
+	 * A shared mapping must use the cached page whatever part of
+	 * it the file covered when it was cached, or its changes
+	 * would be lost. Mappings always start on a page boundary of
+	 * the file, so only the end can differ: if the file has grown
+	 * since, pull in the new part; if it has shrunk, the page
+	 * already has everything this mapping wants.
+	 */
+	if (pp != NULL && reg->rg_shared &&
+	    (pp->pp_lo != lo || pp->pp_hi != hi)) {
+		if (pp->pp_lo != lo) {
+			lock_release(pf->pf_lock);
+			return ENOMEM;
+		}
+		if (hi > pp->pp_hi) {
+			result = pagecache_widen(pf, pp, index, reg, vaddr, hi);
+			if (result) {
+				lock_release(pf->pf_lock);
+				return result;
+			}
+		}
+		lo = pp->pp_lo;
+		hi = pp->pp_hi;
+	}
+
+	if (pp != NULL && pp->pp_lo == lo && pp->pp_hi == hi) {
+		lp = pp->pp_lpage;
+		lpage_lock(lp);
+		result = lpage_pagein(lp, &pa);
+		if (result) {
+			lpage_unlock(lp);
+			lock_release(pf->pf_lock);
+			return result;
+		}
+		lpage_incref(lp);
+		lock_release(pf->pf_lock);
+
+		spinlock_acquire(&pagecache_statslock);
+		pagecache_nhits++;
+		spinlock_release(&pagecache_statslock);
+
+		*lpret = lp;
+		*paddrret = pa;
+		return 0;
+	}
+
+	/* Not cached; read it in. */
+	result = lpage_zerofill(&lp, &pa);
+	if (result) {
+		lock_release(pf->pf_lock);
+		return result;
+	}
+	result = as_loadpage(reg, vaddr, pa);
+	if (result) {
+		lpage_unlock(lp);
+		lock_release(pf->pf_lock);
+		lpage_decref(lp);
+		return result;
+	}
+	if (pp == NULL) {
+		result = pagecache_insert(pf, index, lp, lo, hi);
+		if (result && reg->rg_shared) {
+			/*
+			 * A private page would silently take this
+			 * mapping's changes away from the file and the
+			 * other sharers. Only read-only text can go
+			 * without the cache.
+			 */
+			lpage_unlock(lp);
+			lock_release(pf->pf_lock);
+			lpage_decref(lp);
+			return result;
+		}
+	}
+	lock_release(pf->pf_lock);
+
+	spinlock_acquire(&pagecache_statslock);
+	pagecache_nmisses++;
+	spinlock_release(&pagecache_statslock);
+
+	*lpret = lp;
+	*paddrret = pa;
+	return 0;
+}
+
+bool
+pagecache_peek(struct pcfile *pf, struct region *reg, vaddr_t vaddr,
+	       struct lpage **lpret, paddr_t *paddrret)
+{
+	struct pcpage *pp;
+	struct lpage *lp;
+	unsigned index, lo, hi;
+
+	KASSERT(reg->rg_vnode == pf->pf_vnode);
+
+	pagecache_locate(reg, vaddr, &index, &lo, &hi);
+
+	/* Someone may be reading into the file; don't wait for them. */
+	if (!lock_tryacquire(pf->pf_lock)) {
+		return false;
+	}
+
+	pp = NULL;
+	if (index < array_num(&pf->pf_pages)) {
+		pp = array_get(&pf->pf_pages, index);
+	}
+	if (pp == NULL || pp->pp_lo != lo || pp->pp_hi != hi) {
+		lock_release(pf->pf_lock);
+		return false;
+	}
+
+	lp = pp->pp_lpage;
+	if (!lpage_trylock(lp)) {
+		lock_release(pf->pf_lock);
+		return false;
+	}
+	if (lp->lp_paddr == 0) {
+		lpage_unlock(lp);
+		lock_release(pf->pf_lock);
+		return false;
+	}
+	lpage_incref(lp);
+	lock_release(pf->pf_lock);
+
+	spinlock_acquire(&pagecache_statslock);
+	pagecache_npeeks++;
+	spinlock_release(&pagecache_statslock);
+
+	*lpret = lp;
+	*paddrret = lp->lp_paddr;
+	return true;
+}
+
+/*
+ * Write back the pages of PF that have been changed through shared
+ * mappings. Returns the first error, but tries every page.
+ */
+int
+pagecache_sync(struct pcfile *pf)
+{
+	struct pcpage *pp;
+	unsigned i, num, nwritten;
+	int result, ret;
+
+	ret = 0;
+	nwritten = 0;
+
+	lock_acquire(pf->pf_lock);
+	num = array_num(&pf->pf_pages);
+	for (i=0; i<num; i++) {
+		pp = array_get(&pf->pf_pages, i);
+		if (pp == NULL) {
+			continue;
+		}
+		lpage_lock(pp->pp_lpage);
+		if (pp->pp_lpage->lp_filedirty) {
+			result = lpage_writeback(pp->pp_lpage, pf->pf_vnode,
+						 (off_t)i * PAGE_SIZE,
+						 pp->pp_lo, pp->pp_hi);
+			if (result && ret == 0) {
+				ret = result;
+			}
+			nwritten++;
+		}
+		lpage_unlock(pp->pp_lpage);
+	}
+	lock_release(pf->pf_lock);
+
+	spinlock_acquire(&pagecache_statslock);
+	pagecache_nwritebacks += nwritten;
+	spinlock_release(&pagecache_statslock);
+
+	return ret;
+}
+
+void
+pagecache_syncall(void)
+{
+	unsigned i, num;
+	int result;
+
+	lock_acquire(pagecache_lock);
+	num = array_num(&pagecache_files);
+	for (i=0; i<num; i++) {
+		result = pagecache_sync(array_get(&pagecache_files, i));
+		if (result) {
+			kprintf("pagecache: writeback failed: %s\n",
+				strerror(result));
+		}
+	}
+	lock_release(pagecache_lock);
+}
+
+void
+pagecache_printstats(void)
+{
+	unsigned npages, nhits, nmisses, npeeks, nwritebacks;
+
+	spinlock_acquire(&pagecache_statslock);
+	npages = pagecache_npages;
+	nhits = pagecache_nhits;
+	nmisses = pagecache_nmisses;
+	npeeks = pagecache_npeeks;
+	nwritebacks = pagecache_nwritebacks;
+	spinlock_release(&pagecache_statslock);
+
+	kprintf("pagecache: %u pages cached, %u hits, %u misses, "
+		"%u faulted around, %u pages written back\n",
+		npages, nhits, nmisses, npeeks, nwritebacks);
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <lpage.h>
+#include <pagetable.h>
+#include <vm.h>
+
+/*
+ * Two-level page table.
+ *
+ * Each second-level table is exactly one page of lpage pointers, and
+ * the top level has one entry for each second-level table's worth of
+ * user address space.
+ */
+
+#define PT_L2ENTRIES	(PAGE_SIZE / sizeof(struct lpage *))
+#define PT_L2SPAN	(PT_L2ENTRIES * PAGE_SIZE)
+#define PT_L1ENTRIES	(USERSPACETOP / PT_L2SPAN)
+
+#define PT_L1INDEX(va)	((va) / PT_L2SPAN)
+#define PT_L2INDEX(va)	(((va) / PAGE_SIZE) % PT_L2ENTRIES)
+
+struct pagetable {
+	struct lpage **pt_l2[PT_L1ENTRIES];
+};
+
+struct pagetable *
+pt_create(void)
+{
+	struct pagetable *pt;
+	unsigned i;
+
+	pt = kmalloc(sizeof(*pt));
+	if (pt == NULL) {
+		return NULL;
+	}
+	for (i=0; i<PT_L1ENTRIES; i++) {
+		pt->pt_l2[i] = NULL;
+	}
+	return pt;
+}
+
+void
+pt_destroy(struct pagetable *pt)
+{
+	unsigned i, j;
+	struct lpage **l2;
+
+	for (i=0; i<PT_L1ENTRIES; i++) {
+		l2 = pt->pt_l2[i];
+		if (l2 == NULL) {
+			continue;
+		}
+		for (j=0; j<PT_L2ENTRIES; j++) {
+			if (l2[j] != NULL) {
+				lpage_decref(l2[j]);
+			}
+		}
+		kfree(l2);
+	}
+	kfree(pt);
+}
+
+/*
+ * Allocate an empty second-level table.
+ */
+static
+struct lpage **
+pt_l2create(void)
+{
+	struct lpage **l2;
+	unsigned j;
+
+	l2 = kmalloc(PT_L2ENTRIES * sizeof(struct lpage *));
+	if (l2 == NULL) {
+		return NULL;
+	}
+	for (j=0; j<PT_L2ENTRIES; j++) {
+		l2[j] = NULL;
+	}
+	return l2;
+}
+
+int
+pt_copy(struct pagetable *src, struct pagetable *dst)
+{
+	unsigned i, j;
+	struct lpage **srcl2, **dstl2;
+
+	for (i=0; i<PT_L1ENTRIES; i++) {
+		srcl2 = src->pt_l2[i];
+		if (srcl2 == NULL) {
+			continue;
+		}
+		KASSERT(dst->pt_l2[i] == NULL);
+		dstl2 = pt_l2create();
+		if (dstl2 == NULL) {
+			return ENOMEM;
+		}
+		dst->pt_l2[i] = dstl2;
+
+		for (j=0; j<PT_L2ENTRIES; j++) {
+			if (srcl2[j] == NULL) {
+				continue;
+			}
+			/* Share the page; it becomes copy-on-write. */
+			lpage_incref(srcl2[j]);
+			dstl2[j] = srcl2[j];
+		}
+	}
+	return 0;
+}
+
+void
+pt_clear(struct pagetable *pt, vaddr_t start, vaddr_t end)
+{
+	struct lpage **l2;
+	vaddr_t va;
+
+	KASSERT((start & PAGE_FRAME) == start);
+	KASSERT(end <= USERSPACETOP);
+
+	va = start;
+	while (va < end) {
+		l2 = pt->pt_l2[PT_L1INDEX(va)];
+		if (l2 == NULL) {
+			/* Skip to the next second-level table. */
+			va = (PT_L1INDEX(va) + 1) * PT_L2SPAN;
+			continue;
+		}
+		if (l2[PT_L2INDEX(va)] != NULL) {
+			lpage_decref(l2[PT_L2INDEX(va)]);
+			l2[PT_L2INDEX(va)] = NULL;
+		}
+		va += PAGE_SIZE;
+	}
+}
+
+struct lpage **
+pt_lookup(struct pagetable *pt, vaddr_t vaddr, bool create)
+{
+	struct lpage **l2;
+
+	KASSERT(vaddr < USERSPACETOP);
+
+	l2 = pt->pt_l2[PT_L1INDEX(vaddr)];
+	if (l2 == NULL) {
+		if (!create) {
+			return NULL;
+		}
+		l2 = pt_l2create();
+		if (l2 == NULL) {
+			return NULL;
+		}
+		pt->pt_l2[PT_L1INDEX(vaddr)] = l2;
+	}
+	return &l2[PT_L2INDEX(vaddr)];
+}
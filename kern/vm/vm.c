@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <thread.h>
+#include <current.h>
+#include <addrspace.h>
+#include <pagetable.h>
+#include <lpage.h>
+#include <coremap.h>
+#include <swap.h>
+#include <pagecache.h>
+#include <vm.h>
+
+/*
+ * Machine-independent part of the VM system: page fault handling.
+ * Physical pages come from the coremap (coremap.c).
+ *
+ * User memory is demand-paged: defining a region only records its
+ * bounds, and a physical page is allocated (and zeroed, or read from
+ * the executable) only when a page of the region is first touched.
+ */
+
+void
+vm_bootstrap(void)
+{
+	coremap_bootstrap();
+	lpage_bootstrap();
+	pagecache_bootstrap();
+	mmu_bootstrap();
+	swap_bootstrap();
+}
+
+/*
+ * Idle work: keep a pool of pre-zeroed pages for zero-fill faults.
+ */
+void
+vm_idle(void)
+{
+	coremap_prezero();
+}
+
+/*
+ * Fault-around: after mapping the page at FAULTADDRESS, also map the
+ * other pages of REG in the same aligned window of rg_faultaround
+ * pages that are already resident, so a program streaming through
+ * memory takes one fault per window instead of one per page. That
+ * covers pages in this address space's page table, and pages of
+ * file-backed regions already in the page cache (because another
+ * process touched them) that aren't in the page table yet. Pages
+ * that are busy, paged out, or would have to be read in are skipped;
+ * this never sleeps for I/O or allocates.
+ *
+ * A neighbour is only mapped writeable if a write would not need to
+ * come through vm_fault anyway: the region allows it, the page isn't
+ * copy-on-write, and it is already marked dirty (for both swap and
+ * file purposes). Otherwise it is mapped read-only and the first
+ * write to it takes the normal path.
+ */
+static
+void
+vm_faultaround(struct addrspace *as, struct region *reg,
+	       vaddr_t faultaddress, bool writeable)
+{
+	vaddr_t base, end, va;
+	struct lpage **slot, *lp;
+	paddr_t paddr;
+	size_t window;
+	bool w;
+
+	window = reg->rg_faultaround * PAGE_SIZE;
+	if (window <= PAGE_SIZE) {
+		return;
+	}
+	base = faultaddress & ~(vaddr_t)(window - 1);
+	end = base + window;
+	if (base < reg->rg_base) {
+		base = reg->rg_base;
+	}
+	if (end > reg->rg_base + reg->rg_npages * PAGE_SIZE) {
+		end = reg->rg_base + reg->rg_npages * PAGE_SIZE;
+	}
+
+	for (va = base; va < end; va += PAGE_SIZE) {
+		if (va == faultaddress) {
+			continue;
+		}
+		slot = pt_lookup(as->as_pt, va, false);
+		if (slot == NULL) {
+			continue;
+		}
+		lp = *slot;
+		if (lp == NULL) {
+			if (reg->rg_pcfile == NULL ||
+			    !pagecache_peek(reg->rg_pcfile, reg, va,
+					    &lp, &paddr)) {
+				continue;
+			}
+			*slot = lp;
+		}
+		else if (!lpage_trylock(lp)) {
+			continue;
+		}
+		else if (lp->lp_paddr == 0) {
+			lpage_unlock(lp);
+			continue;
+		}
+		w = writeable && lp->lp_dirty && lp->lp_filedirty &&
+			(reg->rg_shared || !lpage_isshared(lp));
+		mmu_map(as, va, lp->lp_paddr, w);
+		as->as_nprefills++;
+		lpage_unlock(lp);
+	}
+}
+
+/*
+ * Page fault handler.
+ *
+ * Find the region containing the faulting address, growing the stack
+ * if that's where it is, and check the access against its
+ * permissions; then find the page in the page table, creating one if
+ * the page has never been touched, and load the translation into the
+ * MMU. New pages are zero-filled, or read from the backing file for
+ * file-backed regions.
+ *
+ * Pages shared after fork are mapped read-only; a write to one
+ * (VM_FAULT_READONLY, or VM_FAULT_WRITE if it wasn't in the TLB yet)
+ * gets a private copy of the page. (Pages of MAP_SHARED mappings are
+ * shared on purpose and are mapped writeable everywhere.) Pages that
+ * have been evicted are read back in from swap.
+ *
+ * Resident neighbours of the faulting page are mapped along with it;
+ * see vm_faultaround.
+ */
+int
+vm_fault(int faulttype, vaddr_t faultaddress)
+{
+	struct addrspace *as;
+	struct region *reg;
+	struct lpage **slot, *lp, *newlp;
+	paddr_t paddr;
+	bool writeable;
+	int result;
+
+	faultaddress &= PAGE_FRAME;
+
+	DEBUG(DB_VM, "vm: fault: 0x%x\n", faultaddress);
+
+	as = curthread->t_addrspace;
+	if (as == NULL) {
+		/*
+		 * No address space set up. This is probably a kernel
+		 * fault early in boot. Return EFAULT so as to panic
+		 * instead of getting into an infinite faulting loop.
+		 */
+		return EFAULT;
+	}
+
+	/* Try the quick way first. */
+	if (faulttype != VM_FAULT_READONLY) {
+		as->as_ntlbmisses++;
+	}
+	if (mmu_refill(as, faultaddress, faulttype)) {
+		as->as_ntlbrefills++;
+		return 0;
+	}
+	as->as_nfaults++;
+
+	reg = as_findregion(as, faultaddress);
+	if (reg == NULL) {
+		/* Maybe the stack needs to grow. */
+		reg = as_growstack(as, faultaddress);
+		if (reg == NULL) {
+			return EFAULT;
+		}
+	}
+
+	/* While loading, all regions are writeable. */
+	writeable = reg->rg_writeable || as->as_loading;
+
+	switch (faulttype) {
+	    case VM_FAULT_READ:
+		break;
+	    case VM_FAULT_WRITE:
+	    case VM_FAULT_READONLY:
+		if (!writeable) {
+			return EFAULT;
+		}
+		break;
+	    default:
+		return EINVAL;
+	}
+
+	slot = pt_lookup(as->as_pt, faultaddress, true);
+	if (slot == NULL) {
+		return ENOMEM;
+	}
+
+	lp = *slot;
+	if (lp == NULL && reg->rg_pcfile != NULL) {
+		/* First touch of shared text: get it from the page cache. */
+		result = pagecache_getpage(reg->rg_pcfile, reg, faultaddress,
+					   &lp, &paddr);
+		if (result) {
+			return result;
+		}
+		*slot = lp;
+	}
+	else if (lp == NULL) {
+		/*
+		 * First touch: zero-fill on demand, and read in the
+		 * part of the file image, if any, that falls here.
+		 */
+		result = lpage_zerofill(&lp, &paddr);
+		if (result) {
+			return result;
+		}
+		result = as_loadpage(reg, faultaddress, paddr);
+		if (result) {
+			lpage_unlock(lp);
+			lpage_decref(lp);
+			return result;
+		}
+		*slot = lp;
+	}
+	else {
+		lpage_lock(lp);
+		result = lpage_pagein(lp, &paddr);
+		if (result) {
+			lpage_unlock(lp);
+			return result;
+		}
+		if (faulttype != VM_FAULT_READ && !reg->rg_shared &&
+		    lpage_isshared(lp)) {
+			/* Write to a copy-on-write page: copy it. */
+			result = lpage_copy(lp, &newlp, &paddr);
+			lpage_unlock(lp);
+			if (result) {
+				return result;
+			}
+			*slot = newlp;
+			lpage_decref(lp);
+			lp = newlp;
+			/* Cached read-only translations are now wrong. */
+			mmu_invalidate(as, faultaddress);
+		}
+	}
+
+	/*
+	 * Copy-on-write pages must stay read-only so writes come back
+	 * here. Pages of shared mappings are meant to be shared.
+	 */
+	if (writeable && !reg->rg_shared && lpage_isshared(lp)) {
+		writeable = false;
+	}
+
+	KASSERT((paddr & PAGE_FRAME) == paddr);
+
+	/*
+	 * Map the page with the lpage still locked, so it can't be
+	 * paged out in between.
+	 */
+	if (writeable) {
+		lpage_markdirty(lp);
+	}
+	mmu_map(as, faultaddress, paddr, writeable);
+	lpage_unlock(lp);
+
+	vm_faultaround(as, reg, faultaddress,
+		       reg->rg_writeable || as->as_loading);
+	return 0;
+}
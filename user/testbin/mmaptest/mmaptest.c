@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * mmaptest.c
+ *
+ * 	Tests mmap, munmap, and mprotect on anonymous memory: fresh
+ *	mappings read as zero, data survives, parts of a mapping can
+ *	be unmapped and remapped, and bad requests fail cleanly. Then
+ *	maps a file: a shared mapping writes through to the file, a
+ *	private one doesn't, and the open mode is checked, by mprotect
+ *	as well as mmap.
+ *
+ * This should run once mmap is implemented.
+ */
+
+#include <sys/mman.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <err.h>
+
+#define NPAGES		16
+#define PAGESIZE	4096
+#define FILENAME	"mmaptest.dat"
+#define FILEPAGES	2
+
+static char buf[FILEPAGES * PAGESIZE];
+
+static
+void
+fill(char *base, unsigned npages, char seed)
+{
+	unsigned i;
+
+	for (i=0; i<npages*PAGESIZE; i += 512) {
+		base[i] = (char)(seed + i / 512);
+	}
+}
+
+static
+void
+check(char *base, unsigned npages, char seed)
+{
+	unsigned i;
+
+	for (i=0; i<npages*PAGESIZE; i += 512) {
+		if (base[i] != (char)(seed + i / 512)) {
+			errx(1, "Offset %u: wrong contents", i);
+		}
+	}
+}
+
+static
+void
+checkzero(char *base, unsigned npages)
+{
+	unsigned i;
+
+	for (i=0; i<npages*PAGESIZE; i++) {
+		if (base[i] != 0) {
+			errx(1, "Offset %u: not zero", i);
+		}
+	}
+}
+
+static
+void
+expectfail(void *p, int expected, const char *what)
+{
+	if (p != MAP_FAILED) {
+		errx(1, "%s: succeeded", what);
+	}
+	if (errno != expected) {
+		err(1, "%s: failed with the wrong error", what);
+	}
+}
+
+/*
+ * Check that the first FILEPAGES pages of FD have the pattern fill()
+ * makes from SEED.
+ */
+static
+void
+checkfile(int fd, char seed)
+{
+	if (lseek(fd, 0, SEEK_SET) != 0) {
+		err(1, "lseek");
+	}
+	if (read(fd, buf, sizeof(buf)) != sizeof(buf)) {
+		err(1, "read");
+	}
+	check(buf, FILEPAGES, seed);
+}
+
+static
+void
+filetest(void)
+{
+	char *p;
+	int fd, rfd;
+
+	printf("Mapping a file shared...\n");
+	fd = open(FILENAME, O_RDWR | O_CREAT | O_TRUNC, 0664);
+	if (fd < 0) {
+		err(1, "%s", FILENAME);
+	}
+	fill(buf, FILEPAGES, 3);
+	if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+		err(1, "write");
+	}
+
+	p = mmap(NULL, sizeof(buf), PROT_READ | PROT_WRITE, MAP_SHARED,
+		 fd, 0);
+	if (p == MAP_FAILED) {
+		err(1, "mmap MAP_SHARED");
+	}
+	check(p, FILEPAGES, 3);
+	fill(p, FILEPAGES, 4);
+	if (munmap(p, sizeof(buf))) {
+		err(1, "munmap MAP_SHARED");
+	}
+	checkfile(fd, 4);
+
+	printf("Mapping it private...\n");
+	p = mmap(NULL, sizeof(buf), PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		 fd, 0);
+	if (p == MAP_FAILED) {
+		err(1, "mmap MAP_PRIVATE");
+	}
+	check(p, FILEPAGES, 4);
+	fill(p, FILEPAGES, 5);
+	if (munmap(p, sizeof(buf))) {
+		err(1, "munmap MAP_PRIVATE");
+	}
+	checkfile(fd, 4);
+
+	printf("Checking open modes...\n");
+	rfd = open(FILENAME, O_RDONLY);
+	if (rfd < 0) {
+		err(1, "%s: open read-only", FILENAME);
+	}
+	expectfail(mmap(NULL, PAGESIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+			rfd, 0),
+		   EACCES, "Writeable shared mmap of read-only file");
+	p = mmap(NULL, PAGESIZE, PROT_READ, MAP_SHARED, rfd, 0);
+	if (p == MAP_FAILED) {
+		err(1, "Read-only shared mmap of read-only file");
+	}
+	if (mprotect(p, PAGESIZE, PROT_READ | PROT_WRITE) == 0 ||
+	    errno != EACCES) {
+		errx(1, "mprotect of shared mapping of read-only file "
+		     "didn't fail with EACCES");
+	}
+	if (munmap(p, PAGESIZE)) {
+		err(1, "munmap");
+	}
+	p = mmap(NULL, PAGESIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, rfd, 0);
+	if (p == MAP_FAILED) {
+		err(1, "Private mmap of read-only file");
+	}
+	if (munmap(p, PAGESIZE)) {
+		err(1, "munmap");
+	}
+	close(rfd);
+	expectfail(mmap(NULL, PAGESIZE, PROT_READ, MAP_PRIVATE, rfd, 0),
+		   EBADF, "mmap of closed file");
+
+	close(fd);
+	fd = open(FILENAME, O_WRONLY);
+	if (fd < 0) {
+		err(1, "%s: open write-only", FILENAME);
+	}
+	expectfail(mmap(NULL, PAGESIZE, PROT_READ, MAP_PRIVATE, fd, 0),
+		   EACCES, "mmap of write-only file");
+	close(fd);
+	remove(FILENAME);
+}
+
+int
+main(void)
+{
+	char *base, *p;
+
+	printf("Mapping %d pages...\n", NPAGES);
+	base = mmap(NULL, NPAGES * PAGESIZE, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (base == MAP_FAILED) {
+		err(1, "mmap");
+	}
+	checkzero(base, NPAGES);
+	fill(base, NPAGES, 1);
+	check(base, NPAGES, 1);
+
+	printf("Making it read-only and back...\n");
+	if (mprotect(base, NPAGES * PAGESIZE, PROT_READ)) {
+		err(1, "mprotect read-only");
+	}
+	check(base, NPAGES, 1);
+	if (mprotect(base, NPAGES * PAGESIZE, PROT_READ | PROT_WRITE)) {
+		err(1, "mprotect read-write");
+	}
+	fill(base, NPAGES, 2);
+
+	printf("Unmapping the middle...\n");
+	if (munmap(base + 4 * PAGESIZE, 4 * PAGESIZE)) {
+		err(1, "munmap");
+	}
+	check(base, 4, 2);
+	check(base + 8 * PAGESIZE, NPAGES - 8, (char)(2 + 8 * PAGESIZE / 512));
+
+	printf("Mapping the hole again...\n");
+	p = mmap(base + 4 * PAGESIZE, 4 * PAGESIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0);
+	if (p != base + 4 * PAGESIZE) {
+		err(1, "mmap MAP_FIXED");
+	}
+	checkzero(p, 4);
+
+	printf("Advising part of it...\n");
+	if (madvise(base, 4 * PAGESIZE, MADV_RANDOM)) {
+		err(1, "madvise MADV_RANDOM");
+	}
+	if (madvise(base + 8 * PAGESIZE, (NPAGES - 8) * PAGESIZE,
+		    MADV_SEQUENTIAL)) {
+		err(1, "madvise MADV_SEQUENTIAL");
+	}
+	check(base, 4, 2);
+	check(base + 8 * PAGESIZE, NPAGES - 8, (char)(2 + 8 * PAGESIZE / 512));
+	if (madvise(base, NPAGES * PAGESIZE, MADV_NORMAL)) {
+		err(1, "madvise MADV_NORMAL");
+	}
+
+	printf("Trying some bad calls...\n");
+	expectfail(mmap(NULL, 0, PROT_READ, MAP_PRIVATE | MAP_ANON, -1, 0),
+		   EINVAL, "Zero-length mmap");
+	expectfail(mmap(NULL, PAGESIZE, PROT_READ,
+			MAP_SHARED | MAP_PRIVATE | MAP_ANON, -1, 0),
+		   EINVAL, "mmap with MAP_SHARED and MAP_PRIVATE");
+	expectfail(mmap(base, PAGESIZE, PROT_READ,
+			MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0),
+		   EINVAL, "Overlapping MAP_FIXED mmap");
+	if (munmap(base + 1, PAGESIZE) == 0 || errno != EINVAL) {
+		errx(1, "Unaligned munmap didn't fail with EINVAL");
+	}
+	p = (char *)((unsigned long)&main & ~(unsigned long)(PAGESIZE - 1));
+	if (munmap(p, PAGESIZE) == 0 || errno != EINVAL) {
+		errx(1, "munmap of program text didn't fail with EINVAL");
+	}
+	if (madvise(p, PAGESIZE, MADV_RANDOM) == 0 || errno != EINVAL) {
+		errx(1, "madvise of program text didn't fail with EINVAL");
+	}
+	if (madvise(base, PAGESIZE, 42) == 0 || errno != EINVAL) {
+		errx(1, "madvise with bad advice didn't fail with EINVAL");
+	}
+
+	if (munmap(base, NPAGES * PAGESIZE)) {
+		err(1, "Final munmap");
+	}
+
+	filetest();
+
+	printf("mmaptest done.\n");
+	return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * piotest.c
+ *
+ * 	Tests positional and scatter/gather I/O: writev writes its
+ *	buffers in order as one write, readv splits one read across
+ *	buffers, and pread and pwrite work at the position given
+ *	without moving the seek position.
+ *
+ * This should run once pread, pwrite, readv, and writev are
+ * implemented.
+ */
+
+#include <sys/uio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <err.h>
+
+#define FILENAME	"piotest.dat"
+
+static const char header[] = "HEADER:";
+static const char payload[] = "the quick brown fox jumps over the lazy dog";
+
+int
+main(void)
+{
+	struct iovec iov[2];
+	char hbuf[sizeof(header) - 1], pbuf[sizeof(payload) - 1];
+	char buf[16];
+	size_t total;
+	int fd, r;
+
+	total = sizeof(hbuf) + sizeof(pbuf);
+
+	fd = open(FILENAME, O_RDWR | O_CREAT | O_TRUNC, 0664);
+	if (fd < 0) {
+		err(1, "%s", FILENAME);
+	}
+
+	printf("Writing a header and payload with writev...\n");
+	iov[0].iov_base = (void *)header;
+	iov[0].iov_len = sizeof(hbuf);
+	iov[1].iov_base = (void *)payload;
+	iov[1].iov_len = sizeof(pbuf);
+	r = writev(fd, iov, 2);
+	if (r < 0) {
+		err(1, "writev");
+	}
+	if ((size_t)r != total) {
+		errx(1, "writev: short count %d", r);
+	}
+	if (lseek(fd, 0, SEEK_CUR) != (off_t)total) {
+		errx(1, "writev didn't advance the seek position");
+	}
+
+	printf("Reading it back with readv...\n");
+	if (lseek(fd, 0, SEEK_SET) != 0) {
+		err(1, "lseek");
+	}
+	iov[0].iov_base = hbuf;
+	iov[1].iov_base = pbuf;
+	r = readv(fd, iov, 2);
+	if (r < 0) {
+		err(1, "readv");
+	}
+	if ((size_t)r != total) {
+		errx(1, "readv: short count %d", r);
+	}
+	if (memcmp(hbuf, header, sizeof(hbuf)) ||
+	    memcmp(pbuf, payload, sizeof(pbuf))) {
+		errx(1, "readv: wrong data");
+	}
+
+	printf("Checking pread and pwrite...\n");
+	if (lseek(fd, 3, SEEK_SET) != 3) {
+		err(1, "lseek");
+	}
+	r = pread(fd, buf, 5, sizeof(hbuf) + 4);
+	if (r != 5) {
+		err(1, "pread");
+	}
+	if (memcmp(buf, payload + 4, 5)) {
+		errx(1, "pread: wrong data");
+	}
+	if (pwrite(fd, "QUICK", 5, sizeof(hbuf) + 4) != 5) {
+		err(1, "pwrite");
+	}
+	if (lseek(fd, 0, SEEK_CUR) != 3) {
+		errx(1, "pread/pwrite moved the seek position");
+	}
+	r = pread(fd, buf, 9, sizeof(hbuf));
+	if (r != 9) {
+		err(1, "pread");
+	}
+	if (memcmp(buf, "the QUICK", 9)) {
+		errx(1, "pwrite: wrong data");
+	}
+
+	printf("Trying some bad calls...\n");
+	if (pread(fd, buf, 1, -1) >= 0 || errno != EINVAL) {
+		errx(1, "pread at negative offset didn't fail with EINVAL");
+	}
+	if (readv(fd, iov, 0) >= 0 || errno != EINVAL) {
+		errx(1, "readv of no buffers didn't fail with EINVAL");
+	}
+	if (pread(STDIN_FILENO, buf, 1, 0) >= 0 || errno != ESPIPE) {
+		errx(1, "pread on the console didn't fail with ESPIPE");
+	}
+
+	close(fd);
+	remove(FILENAME);
+
+	printf("piotest done.\n");
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * pipetest.c
+ *
+ * 	Tests pipes within one process: data comes out the way it went
+ *	in, reads return what is there without waiting for more, a
+ *	pipe whose write end is closed reads as end of file, and one
+ *	whose read end is closed fails writes with EPIPE.
+ *
+ * This should run once pipe is implemented.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <err.h>
+
+#define CHUNK	1000
+#define NCHUNKS	3
+
+static char buf[CHUNK * NCHUNKS];
+static char rbuf[CHUNK * (NCHUNKS + 1)];
+
+int
+main(void)
+{
+	int fds[2];
+	unsigned i;
+	int r;
+
+	printf("Writing and reading a pipe...\n");
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+	for (i=0; i<sizeof(buf); i++) {
+		buf[i] = (char)(i * 7 + i / 256);
+	}
+	for (i=0; i<NCHUNKS; i++) {
+		r = write(fds[1], buf + i * CHUNK, CHUNK);
+		if (r != CHUNK) {
+			err(1, "write");
+		}
+	}
+
+	/* Ask for more than there is; should get what's there. */
+	r = read(fds[0], rbuf, sizeof(rbuf));
+	if (r < 0) {
+		err(1, "read");
+	}
+	if (r != sizeof(buf) || memcmp(buf, rbuf, sizeof(buf))) {
+		errx(1, "read: got %d bytes, or wrong data", r);
+	}
+
+	printf("Checking end of file...\n");
+	if (write(fds[1], "x", 1) != 1) {
+		err(1, "write");
+	}
+	close(fds[1]);
+	r = read(fds[0], rbuf, sizeof(rbuf));
+	if (r != 1 || rbuf[0] != 'x') {
+		errx(1, "read after close: expected 1 byte, got %d", r);
+	}
+	r = read(fds[0], rbuf, sizeof(rbuf));
+	if (r != 0) {
+		errx(1, "read at end of file: expected 0, got %d", r);
+	}
+	close(fds[0]);
+
+	printf("Checking broken pipe...\n");
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+	close(fds[0]);
+	if (write(fds[1], "x", 1) >= 0 || errno != EPIPE) {
+		errx(1, "write to broken pipe didn't fail with EPIPE");
+	}
+	if (read(fds[1], rbuf, 1) >= 0 || errno != EBADF) {
+		errx(1, "read from write end didn't fail with EBADF");
+	}
+	close(fds[1]);
+
+	printf("pipetest done.\n");
+	return 0;
+}
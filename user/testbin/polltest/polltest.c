@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * polltest.c
+ *
+ * 	Tests poll and select on pipes within one process: an empty
+ *	pipe isn't readable, one with data is, one whose write end is
+ *	closed reports end of file, a full pipe isn't writeable, a
+ *	timeout expires, and bad file descriptors are caught.
+ *
+ * This should run once poll, select, and pipe are implemented.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <errno.h>
+#include <err.h>
+
+static char buf[8192];
+
+/*
+ * Poll one file for EVENTS with no waiting and check what comes back.
+ */
+static
+void
+check1(const char *what, int fd, int events, int expected)
+{
+	struct pollfd pfd;
+	int r;
+
+	pfd.fd = fd;
+	pfd.events = events;
+	pfd.revents = 0;
+	r = poll(&pfd, 1, 0);
+	if (r < 0) {
+		err(1, "%s: poll", what);
+	}
+	if (pfd.revents != expected || r != (expected != 0)) {
+		errx(1, "%s: poll returned %d with revents 0x%x, expected 0x%x",
+		     what, r, pfd.revents, expected);
+	}
+}
+
+static
+void
+polltest(void)
+{
+	struct pollfd pfds[3];
+	time_t s0, s1;
+	int fds[2];
+	int r;
+
+	printf("Testing poll...\n");
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+
+	check1("empty pipe", fds[0], POLLIN, 0);
+	check1("empty pipe", fds[1], POLLOUT, POLLOUT);
+
+	if (write(fds[1], "x", 1) != 1) {
+		err(1, "write");
+	}
+	check1("nonempty pipe", fds[0], POLLIN, POLLIN);
+
+	/* Fill it up; it shouldn't be writeable any more. */
+	if (read(fds[0], buf, 1) != 1) {
+		err(1, "read");
+	}
+	while (1) {
+		pfds[0].fd = fds[1];
+		pfds[0].events = POLLOUT;
+		if (poll(pfds, 1, 0) < 0) {
+			err(1, "poll");
+		}
+		if (pfds[0].revents == 0) {
+			break;
+		}
+		if (write(fds[1], buf, 512) < 0) {
+			err(1, "write");
+		}
+	}
+	check1("full pipe", fds[0], POLLIN, POLLIN);
+
+	/* Two files and a skipped slot, in one call with a timeout. */
+	pfds[0].fd = fds[0];
+	pfds[0].events = POLLIN;
+	pfds[1].fd = -1;
+	pfds[1].events = POLLIN;
+	pfds[2].fd = fds[1];
+	pfds[2].events = POLLOUT;
+	r = poll(pfds, 3, 1000);
+	if (r != 1 || pfds[0].revents != POLLIN || pfds[1].revents != 0 ||
+	    pfds[2].revents != 0) {
+		errx(1, "poll of three: got %d", r);
+	}
+
+	/* Drain it, then wait on the empty pipe for a second. */
+	while (poll(pfds, 1, 0) == 1) {
+		if (read(fds[0], buf, sizeof(buf)) <= 0) {
+			err(1, "read");
+		}
+	}
+	printf("Waiting for a timeout...\n");
+	s0 = time(NULL);
+	r = poll(pfds, 1, 1000);
+	s1 = time(NULL);
+	if (r != 0 || pfds[0].revents != 0) {
+		errx(1, "poll of empty pipe: got %d", r);
+	}
+	if (s1 == s0) {
+		errx(1, "poll timed out too soon");
+	}
+
+	close(fds[1]);
+	check1("widowed pipe", fds[0], POLLIN, POLLIN | POLLHUP);
+	check1("closed fd", fds[1], POLLIN, POLLNVAL);
+	close(fds[0]);
+
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+	close(fds[0]);
+	check1("broken pipe", fds[1], POLLOUT, POLLOUT | POLLERR);
+	close(fds[1]);
+}
+
+static
+void
+selecttest(void)
+{
+	fd_set rfds, wfds;
+	struct timeval tv;
+	int fds[2];
+	int r;
+
+	printf("Testing select...\n");
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+
+	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
+	FD_SET(fds[0], &rfds);
+	FD_SET(fds[1], &wfds);
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	r = select(fds[1] + 1, &rfds, &wfds, NULL, &tv);
+	if (r != 1 || FD_ISSET(fds[0], &rfds) || !FD_ISSET(fds[1], &wfds)) {
+		errx(1, "select on empty pipe: got %d", r);
+	}
+
+	if (write(fds[1], "x", 1) != 1) {
+		err(1, "write");
+	}
+	FD_ZERO(&rfds);
+	FD_SET(fds[0], &rfds);
+	r = select(fds[0] + 1, &rfds, NULL, NULL, NULL);
+	if (r != 1 || !FD_ISSET(fds[0], &rfds)) {
+		errx(1, "select on nonempty pipe: got %d", r);
+	}
+
+	close(fds[1]);
+	FD_ZERO(&rfds);
+	FD_SET(fds[1], &rfds);
+	r = select(fds[1] + 1, &rfds, NULL, NULL, &tv);
+	if (r >= 0 || errno != EBADF) {
+		errx(1, "select on closed fd didn't fail with EBADF");
+	}
+	close(fds[0]);
+}
+
+int
+main(void)
+{
+	polltest();
+	selecttest();
+	printf("polltest done.\n");
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * sbrktest.c
+ *
+ * 	Grows and shrinks the heap with sbrk, checking that new heap
+ *	memory reads as zero, that data survives while the heap is
+ *	in use, and that bad requests fail cleanly.
+ *
+ * This should run once sbrk is implemented.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <err.h>
+
+#define NPAGES		64
+#define PAGESIZE	4096
+
+static
+void
+fill(char *base, unsigned npages)
+{
+	unsigned i;
+
+	for (i=0; i<npages; i++) {
+		base[i*PAGESIZE] = (char)(i + 1);
+		base[i*PAGESIZE + PAGESIZE - 1] = (char)(i + 2);
+	}
+}
+
+static
+void
+check(char *base, unsigned npages)
+{
+	unsigned i;
+
+	for (i=0; i<npages; i++) {
+		if (base[i*PAGESIZE] != (char)(i + 1) ||
+		    base[i*PAGESIZE + PAGESIZE - 1] != (char)(i + 2)) {
+			errx(1, "Page %u: wrong contents", i);
+		}
+	}
+}
+
+static
+void
+checkzero(char *base, unsigned npages)
+{
+	unsigned i, j;
+
+	for (i=0; i<npages; i++) {
+		for (j=0; j<PAGESIZE; j++) {
+			if (base[i*PAGESIZE + j] != 0) {
+				errx(1, "Page %u offset %u: not zero", i, j);
+			}
+		}
+	}
+}
+
+int
+main(void)
+{
+	char *base, *p;
+
+	base = sbrk(0);
+	if (base == (void *)-1) {
+		err(1, "sbrk(0)");
+	}
+	printf("Heap starts at %p\n", base);
+
+	printf("Growing by %d pages...\n", NPAGES);
+	p = sbrk(NPAGES * PAGESIZE);
+	if (p == (void *)-1) {
+		err(1, "sbrk grow");
+	}
+	if (p != base) {
+		errx(1, "sbrk returned %p, expected %p", p, base);
+	}
+	checkzero(base, NPAGES);
+	fill(base, NPAGES);
+	check(base, NPAGES);
+
+	printf("Shrinking by half...\n");
+	p = sbrk(-(NPAGES / 2) * PAGESIZE);
+	if (p != base + NPAGES * PAGESIZE) {
+		errx(1, "sbrk shrink returned %p", p);
+	}
+	check(base, NPAGES / 2);
+
+	printf("Growing back...\n");
+	p = sbrk((NPAGES / 2) * PAGESIZE);
+	if (p != base + (NPAGES / 2) * PAGESIZE) {
+		errx(1, "sbrk regrow returned %p", p);
+	}
+	check(base, NPAGES / 2);
+	checkzero(p, NPAGES / 2);
+
+	printf("Shrinking below the start of the heap...\n");
+	p = sbrk(-(NPAGES + 1) * PAGESIZE);
+	if (p != (void *)-1) {
+		errx(1, "sbrk succeeded");
+	}
+	if (errno != EINVAL) {
+		err(1, "sbrk failed with the wrong error");
+	}
+
+	printf("Growing into the stack...\n");
+	p = sbrk(0x7fffffff);
+	if (p != (void *)-1) {
+		errx(1, "sbrk succeeded");
+	}
+	if (errno != ENOMEM) {
+		err(1, "sbrk failed with the wrong error");
+	}
+
+	p = sbrk(-NPAGES * PAGESIZE);
+	if (p != base + NPAGES * PAGESIZE || sbrk(0) != base) {
+		errx(1, "Final shrink failed");
+	}
+
+	printf("sbrktest done.\n");
+	return 0;
+}
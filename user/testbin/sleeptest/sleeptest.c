@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * sleeptest.c
+ *
+ * 	Tests timed sleeps: nanosleep and a poll timeout should each
+ *	wait at least as long as asked, but nowhere near a whole second
+ *	longer, and nanosleep should reject bad times.
+ *
+ * This should run once nanosleep and poll are implemented.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <err.h>
+
+/* Anything this much past the deadline means one-second ticks. */
+#define SLOP_MS 500
+
+/*
+ * Get the time in milliseconds.
+ */
+static
+unsigned long
+getms(void)
+{
+	time_t secs;
+	unsigned long nsecs;
+
+	__time(&secs, &nsecs);
+	return secs * 1000 + nsecs / 1000000;
+}
+
+static
+void
+check(const char *what, unsigned long start, unsigned long ms)
+{
+	unsigned long took;
+
+	took = getms() - start;
+	printf("%s: asked for %lu ms, took %lu ms\n", what, ms, took);
+	if (took < ms) {
+		errx(1, "%s: woke up too soon", what);
+	}
+	if (took > ms + SLOP_MS) {
+		errx(1, "%s: woke up too late", what);
+	}
+}
+
+static
+void
+napme(unsigned long ms)
+{
+	struct timespec ts, rem;
+	unsigned long start;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+	start = getms();
+	if (nanosleep(&ts, &rem) < 0) {
+		err(1, "nanosleep");
+	}
+	check("nanosleep", start, ms);
+}
+
+static
+void
+pollme(int ms)
+{
+	unsigned long start;
+
+	start = getms();
+	if (poll(NULL, 0, ms) != 0) {
+		err(1, "poll");
+	}
+	check("poll", start, ms);
+}
+
+int
+main(void)
+{
+	struct timespec ts;
+
+	napme(0);
+	napme(10);
+	napme(50);
+	napme(1200);
+	pollme(30);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 1000000000;
+	if (nanosleep(&ts, NULL) >= 0 || errno != EINVAL) {
+		errx(1, "nanosleep of a bad time didn't fail with EINVAL");
+	}
+
+	printf("sleeptest done.\n");
+	return 0;
+}
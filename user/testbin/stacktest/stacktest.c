@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * stacktest.c
+ *
+ * 	Recurses deeply enough to need many pages of stack, checking
+ *	that the stack grows on demand and keeps its contents.
+ *
+ * This should run once the stack grows automatically.
+ */
+
+#include <stdio.h>
+#include <err.h>
+
+/* About 1K of stack per call, 200 calls: about 50 pages. */
+#define DEPTH		200
+#define FRAMEWORDS	256
+
+static
+unsigned
+recurse(unsigned depth)
+{
+	volatile unsigned frame[FRAMEWORDS];
+	unsigned i, sum;
+
+	for (i=0; i<FRAMEWORDS; i++) {
+		frame[i] = depth * FRAMEWORDS + i;
+	}
+
+	sum = depth == 0 ? 0 : recurse(depth - 1);
+
+	for (i=0; i<FRAMEWORDS; i++) {
+		if (frame[i] != depth * FRAMEWORDS + i) {
+			errx(1, "Depth %u: frame word %u clobbered", depth, i);
+		}
+	}
+	return sum + depth;
+}
+
+int
+main(void)
+{
+	unsigned sum;
+
+	printf("Recursing %d levels...\n", DEPTH);
+	sum = recurse(DEPTH);
+	if (sum != DEPTH * (DEPTH + 1) / 2) {
+		errx(1, "Wrong sum %u", sum);
+	}
+	printf("stacktest done.\n");
+	return 0;
+}
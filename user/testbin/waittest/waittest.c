@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * waittest.c
+ *
+ * 	Tests the process calls: fork returns distinct pids, waitpid
+ *	collects exit statuses (including from processes killed by a
+ *	fault) and refuses processes that aren't our children, WNOHANG
+ *	doesn't wait, and execv passes arguments. Then times a batch
+ *	of forks.
+ *
+ * This should run once fork, execv, waitpid, and _exit are
+ * implemented.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <err.h>
+
+#define NFORKS	200
+
+static
+pid_t
+dofork(void)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		err(1, "fork");
+	}
+	return pid;
+}
+
+static
+int
+dowait(pid_t pid)
+{
+	int status;
+
+	if (waitpid(pid, &status, 0) != pid) {
+		err(1, "waitpid");
+	}
+	return status;
+}
+
+static
+void
+statustest(void)
+{
+	pid_t mypid, pid;
+	int fds[2];
+	char ch;
+	int status;
+
+	printf("Checking exit status...\n");
+	mypid = getpid();
+	pid = dofork();
+	if (pid == 0) {
+		if (getpid() == mypid) {
+			_exit(1);
+		}
+		_exit(42);
+	}
+	if (pid == mypid) {
+		errx(1, "child has the parent's pid");
+	}
+	status = dowait(pid);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 42) {
+		errx(1, "child exit status 0x%x, expected 42", status);
+	}
+	if (waitpid(pid, &status, 0) >= 0 || errno != ESRCH) {
+		errx(1, "second waitpid didn't fail with ESRCH");
+	}
+	if (waitpid(mypid, &status, 0) >= 0 || errno != ECHILD) {
+		errx(1, "waitpid on self didn't fail with ECHILD");
+	}
+
+	printf("Checking WNOHANG...\n");
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+	pid = dofork();
+	if (pid == 0) {
+		/* Wait until the parent has looked. */
+		close(fds[1]);
+		read(fds[0], &ch, 1);
+		_exit(0);
+	}
+	close(fds[0]);
+	if (waitpid(pid, &status, WNOHANG) != 0) {
+		errx(1, "WNOHANG waitpid on running child didn't return 0");
+	}
+	close(fds[1]);
+	status = dowait(pid);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		errx(1, "child exit status 0x%x, expected 0", status);
+	}
+
+	printf("Checking a child killed by a fault (expect a message)...\n");
+	pid = dofork();
+	if (pid == 0) {
+		volatile int *p = NULL;
+		*p = 0;
+		_exit(0);
+	}
+	status = dowait(pid);
+	if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGSEGV) {
+		errx(1, "child exit status 0x%x, expected SIGSEGV", status);
+	}
+}
+
+static
+void
+exectest(const char *prog)
+{
+	char *args[4];
+	pid_t pid;
+	int status;
+
+	printf("Checking execv...\n");
+	pid = dofork();
+	if (pid == 0) {
+		args[0] = (char *)prog;
+		args[1] = (char *)"child";
+		args[2] = (char *)"7";
+		args[3] = NULL;
+		execv(prog, args);
+		err(1, "execv");
+	}
+	status = dowait(pid);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 7) {
+		errx(1, "exec'd child exit status 0x%x, expected 7", status);
+	}
+}
+
+static
+void
+forkbench(void)
+{
+	time_t s0, s1;
+	unsigned long ns0, ns1, ms;
+	unsigned i;
+	pid_t pid;
+
+	printf("Timing %d forks...\n", NFORKS);
+	s0 = __time(NULL, &ns0);
+	for (i=0; i<NFORKS; i++) {
+		pid = dofork();
+		if (pid == 0) {
+			_exit(0);
+		}
+		dowait(pid);
+	}
+	s1 = __time(NULL, &ns1);
+
+	ms = (s1 - s0) * 1000 + ns1 / 1000000 - ns0 / 1000000;
+	if (ms == 0) {
+		ms = 1;
+	}
+	printf("%d forks in %lu ms: %lu forks/sec\n", NFORKS, ms,
+	       NFORKS * 1000UL / ms);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc == 3 && !strcmp(argv[1], "child")) {
+		/* Exec'd by exectest */
+		return atoi(argv[2]);
+	}
+
+	statustest();
+	exectest(argc > 0 ? argv[0] : "/testbin/waittest");
+	forkbench();
+	printf("waittest done.\n");
+	return 0;
+}